@@ -20,6 +20,11 @@ public:
     std::unique_ptr<BVHNode> right = nullptr;
     std::vector<std::pair<int, int>> triangleIndices; // object idx and triangle idx
 
+    // set for leaves once the geometry is paged out (see GeometryPager)
+    int pageIdx = -1;
+    int pageFirst = 0;
+    int pageCount = 0;
+
     BVHNode();
     void createBB(std::vector<Triangle>& trianglesInNode);
 };
@@ -0,0 +1,100 @@
+#ifndef GEOMETRYPAGER_H
+#define GEOMETRYPAGER_H
+
+#include <kanima/linalg/vec3.h>
+#include <kanima/core/baryCoord.h>
+#include <kanima/core/mesh.h>
+#include <kanima/accTree/bvhnode.h>
+#include <kanima/util/mappedFile.h>
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+namespace krt
+{
+
+// Everything traversal and shading need from one triangle, stored in the page file
+struct PagedTriangle
+{
+    vec3 v0, v1, v2;
+    vec3 normal;
+    vec3 n0, n1, n2; // vertex normals
+    vec3 uv0, uv1, uv2;
+    int meshIdx;
+    int triangleIdx;
+
+    BaryCoord findBaryCentricCoords(const vec3& point) const;
+    vec3 findInterpolatedVertNormal(const BaryCoord& bary) const;
+    void findTextureUV(const BaryCoord& bary, float& u, float& v) const;
+};
+
+// resident copy of one page
+struct GeometryPage
+{
+    std::vector<PagedTriangle> triangles;
+};
+
+struct GeometryPagerStats
+{
+    uint64_t pageFaults;
+    uint64_t cacheHits;
+    size_t residentPages;
+    size_t maxResidentPages;
+    size_t pageCount;
+};
+
+// Out-of-core triangle storage. create() writes the triangles of every BVH leaf, in
+// tree order, into a page file and points the leaves at (page, first, count) ranges.
+// The mesh arrays are then released. Pages are read back from the memory mapped file
+// into a bounded LRU cache on demand; the file's mapped pages are dropped after each
+// copy so only the cache stays resident.
+class GeometryPager
+{
+private:
+    MappedFile file;
+    std::vector<size_t> pageOffsets; // byte offset of each page in the file
+    std::vector<int> pageSizes;      // triangles per page
+
+    std::mutex mtx;
+    std::list<int> lru; // most recently used first
+    struct Entry
+    {
+        std::shared_ptr<const GeometryPage> page;
+        std::list<int>::iterator lruPos;
+    };
+    std::unordered_map<int, Entry> resident;
+    size_t maxResidentPages;
+
+    std::atomic<uint64_t> pageFaults;
+    std::atomic<uint64_t> cacheHits;
+
+    std::shared_ptr<const GeometryPage> readPage(int pageIdx);
+
+public:
+    GeometryPager();
+
+    GeometryPager(const GeometryPager&) = delete;
+    GeometryPager& operator=(const GeometryPager&) = delete;
+
+    // Pages are filled with whole leaves up to trianglesPerPage triangles (a larger leaf
+    // gets a page of its own). The file is unlinked once mapped, so it is removed when
+    // the pager goes away. Returns false if the file cannot be written or mapped, the
+    // leaves and meshes are then left as they were.
+    bool create(const std::string& fileName, std::vector<Mesh>& meshes, BVHNode* root,
+                size_t maxResidentBytes, int trianglesPerPage);
+
+    // the page stays valid for as long as the returned pointer is held, even if evicted
+    std::shared_ptr<const GeometryPage> acquire(int pageIdx);
+
+    GeometryPagerStats stats();
+    void resetStats();
+};
+
+}
+#endif // GEOMETRYPAGER_H
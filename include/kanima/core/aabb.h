@@ -4,6 +4,7 @@
 #include <kanima/linalg/vec3.h>
 #include <kanima/core/ray.h>
 #include <limits>
+#include <algorithm>
 
 const double EPSILON = 1e-6;
 
@@ -44,6 +45,28 @@ public:
     }
 
 
+    const vec3& getMinVertex() const
+    {
+        return min_vertex;
+    }
+
+    const vec3& getMaxVertex() const
+    {
+        return max_vertex;
+    }
+
+    // smallest box containing both boxes
+    AABB merged(const AABB& other) const
+    {
+        vec3 minv = vec3(std::min(min_vertex.x, other.min_vertex.x),
+                         std::min(min_vertex.y, other.min_vertex.y),
+                         std::min(min_vertex.z, other.min_vertex.z));
+        vec3 maxv = vec3(std::max(max_vertex.x, other.max_vertex.x),
+                         std::max(max_vertex.y, other.max_vertex.y),
+                         std::max(max_vertex.z, other.max_vertex.z));
+        return AABB(minv, maxv);
+    }
+
     bool rayIntersectBox(const Ray& ray) const
     {
         float tMin = -std::numeric_limits<float>::infinity();
@@ -18,6 +18,7 @@ public:
     Color(float r, float g, float b);
 
     Color operator*(float scalar) const;
+    Color operator*(const Color& other) const; // per channel
     friend Color operator*(float scalar, const Color& c);
     Color operator+(const Color& other);
 };
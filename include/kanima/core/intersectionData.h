@@ -16,6 +16,9 @@ struct IntersectionData
     const Material* material;
     int objectIdx = -1;
     int triangleIdx = -1;
+    bool hasTextureUV = false; // set when the mesh data is paged out and uv is resolved during the trace
+    float textureU = 0;
+    float textureV = 0;
 };
 }
 
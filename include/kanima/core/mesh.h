@@ -23,14 +23,15 @@ public:
     void setUniformColor(const Color &color);
     void setRandomColors();
     void setMaterial(const Material& material);
-    void computeTriangleNormals();
-    void computeVertexNormals();
+    // numThreads > 1 splits large meshes across threads, results match the serial version
+    void computeTriangleNormals(int numThreads = 1);
+    void computeVertexNormals(int numThreads = 1);
     BaryCoord findBaryCentricCoords(vec3& point, int triangleIndex) const;
     vec3 findInterpolatedVertNormal(BaryCoord& baryCentricCoord, int triangleIndex) const;
     double intersectRay(const Ray& r, int& hitTriangleIndex, vec3& hitPoint, vec3& hitNormal, bool cullBackFaces) const;
     Color getAlbedo(BaryCoord& baryPoint, int triangleIndex);
     void insertVectorUVs(float u, float v, float w);
-    void computeAABB();
+    void computeAABB(int numThreads = 1);
 
     Color uniformColor;
     bool randomizeColors;
@@ -0,0 +1,27 @@
+#ifndef MESHLOADER_H
+#define MESHLOADER_H
+
+#include <kanima/core/mesh.h>
+
+#include <string>
+
+namespace krt
+{
+
+// Loaders for external mesh files. The file is memory mapped; ASCII files are split
+// into line-aligned chunks that are parsed on numThreads threads and then stitched
+// into mesh.vertices and mesh.triangleVertIndices. Binary PLY is decoded straight
+// from the mapping. Polygons are fan-triangulated and degenerate triangles dropped.
+// Triangle normals, vertex normals and the AABB are computed before returning.
+// numThreads <= 0 uses the hardware concurrency. Returns false on failure.
+
+bool loadOBJ(const std::string& fileName, Mesh& mesh, int numThreads = 0);
+
+// ascii, binary_little_endian and binary_big_endian. Per-vertex u/v (or s/t) are read into vertexUVs.
+bool loadPLY(const std::string& fileName, Mesh& mesh, int numThreads = 0);
+
+// picks the loader from the file extension (.obj or .ply)
+bool loadMeshFromFile(const std::string& fileName, Mesh& mesh, int numThreads = 0);
+
+}
+#endif // MESHLOADER_H
@@ -2,6 +2,9 @@
 #define RAY_H
 
 #include "../linalg/vec3.h"
+#include "color.h"
+
+#include <cstdint>
 
 namespace krt
 {
@@ -21,15 +24,23 @@ public:
     vec3 d; // direction
     RayType type;
     int pathDepth;
+    uint32_t pathId; // tells the sampler apart branches of the same camera sample
+    Color throughput; // weight of the ray's radiance in the pixel
+    bool afterDiffuse = false; // the path has bounced off a diffuse surface before
+
+    Ray() : type(RayType::invalid), pathDepth(0), pathId(0), throughput(0, 0, 0) {};
 
-    Ray(const vec3& o, const vec3& d) : o(o), d(d), type(RayType::camera), pathDepth(1) {};
+    Ray(const vec3& o, const vec3& d) : o(o), d(d), type(RayType::camera), pathDepth(1), pathId(0), throughput(1, 1, 1) {};
 
-    Ray(const vec3& o, const vec3& d, RayType type, int pathDepth) : o(o), d(d), type(type), pathDepth(pathDepth) {};
+    Ray(const vec3& o, const vec3& d, RayType type, int pathDepth, uint32_t pathId = 0, const Color& throughput = Color(1, 1, 1))
+        : o(o), d(d), type(type), pathDepth(pathDepth), pathId(pathId), throughput(throughput) {};
 
     Ray reflectedRay(const vec3& normal, const vec3& point) const
     {
         vec3 newD = this->d - (normal * (this->d.dot(normal)) * 2.f);
-        return Ray(point, newD.normalized(), this->type, this->pathDepth + 1);
+        Ray reflected(point, newD.normalized(), this->type, this->pathDepth + 1, this->pathId, this->throughput);
+        reflected.afterDiffuse = this->afterDiffuse;
+        return reflected;
     }
 };
 
@@ -14,14 +14,53 @@
 #include <kanima/texture/edgeTexture.h>
 #include <kanima/core/triangle.h>
 #include <kanima/accTree/bvhnode.h>
+#include <kanima/accTree/geometryPager.h>
+#include <kanima/util/renderContext.h>
 
 #include <vector>
 #include <unordered_map>
 #include <memory>
 #include <string>
+#include <ostream>
+#include <cstdint>
 
 namespace krt
 {
+
+// Seconds spent in each phase of parseSceneFile. The per-mesh phases run on the
+// mesh workers while parsing continues and are summed over the workers.
+struct SceneLoadStats
+{
+    double readSeconds = 0;           // file read and JSON parse
+    double extractSeconds = 0;        // textures, materials, objects and lights from the document
+    double triangleNormalSeconds = 0;
+    double vertexNormalSeconds = 0;
+    double aabbSeconds = 0;
+    double meshBVHSeconds = 0;
+    double pipelineWaitSeconds = 0;   // mesh work left after parsing, including the top-level BVH
+    double topLevelBVHSeconds = 0;
+    double textureWaitSeconds = 0;    // blocked on background image decodes
+    double totalSeconds = 0;
+
+    void print(std::ostream& out) const;
+};
+
+// Rays traced on the calling thread so far, shadow rays included. traceRay and
+// traceRayBVH count themselves, other intersection loops call countTracedRays.
+uint64_t tracedRayCount();
+void countTracedRays(uint64_t rays);
+
+// rays traced together by Scene::tracePacketBVH
+const int RAY_PACKET_SIZE = 8;
+
+// How many global illumination rays leave a diffuse hit
+enum class GIMode
+{
+    Split,        // gi_ray_count at every diffuse hit, rays grow as gi_ray_count^depth
+    PrimarySplit, // gi_ray_count at the first diffuse hit of a path, one at the later ones
+    Path          // one at every diffuse hit, more samples per pixel reduce the noise
+};
+
 class Scene
 {
 private:
@@ -35,16 +74,27 @@ public:
     std::vector<Light> lights;
     std::vector<Material> meshMaterials;
     std::unordered_map<std::string, std::shared_ptr<Texture>> textureMap;
+    ImageCache imageCache; // bitmap textures loaded from the scene file, shared by path
     int bucketSize = 24;
     std::unique_ptr<BVHNode> bvhRoot = nullptr;
     int max_bvhtree_depth = 24;
     int min_triangles_per_bvhnode = 4;
     bool useBVH = false;
     int gi_ray_count = 0;
+    GIMode gi_mode = GIMode::Split;
+    int rr_start_depth = 3;         // russian roulette for rays deeper than this, 0 for none
+    float rr_min_throughput = 1e-3f; // paths below this throughput go through russian roulette
+    int fresnel_branch_depth = 1;    // refractive hits of rays up to this depth trace both branches
+    int load_threads = 0; // tasks a large mesh is split into while loading, <= 0 uses the hardware concurrency
+    bool build_bvh_on_load = true; // per-mesh BVHs are built while the file is parsed
+    SceneLoadStats loadStats;
+    std::unique_ptr<GeometryPager> geometryPager = nullptr; // set once the triangles are paged out of memory
 
 
     Scene();
     Scene(const std::string& sceneFileName);
+    // loads on the context's thread pool instead of the default one
+    Scene(const std::string& sceneFileName, RenderContext& context);
     void addMesh(Mesh& mesh);
     std::vector<Mesh> getMeshes();
     void parseSceneFile(const std::string& sceneFileName);
@@ -55,7 +105,19 @@ public:
     std::vector<Triangle> getAllTrianglesInScene();
     double shortestIntersectionInNode(BVHNode* node, const Ray &ray, int &hitTriangleIdx, int &hitObjectIdx, vec3 &hitPoint, vec3 &hitNormal);
     IntersectionData traceRayBVH(const Ray& ray);
+    // Closest hits of up to RAY_PACKET_SIZE coherent rays, the ones traceRayBVH gives.
+    // The rays share the node visits and leaf triangles. Rays with a common origin,
+    // like camera rays, skip a box the whole packet misses after one frustum test.
+    void tracePacketBVH(const Ray* rays, int count, IntersectionData* hits);
     std::unique_ptr<BVHNode> buildBVHTree(std::vector<Triangle>& allTrianglesInParent, int depth);
+    // Moves the triangles of the built BVH into a page file and frees the mesh arrays.
+    // Traversal then goes through the pager; there is no way back to resident meshes.
+    bool enablePagedGeometry(const std::string& pageFileName, size_t maxResidentBytes, int trianglesPerPage);
+    double shortestIntersectionInPagedNode(BVHNode* node, const Ray& ray, PagedTriangle& hitTriangle, vec3& hitPoint);
+    IntersectionData traceRayPaged(const Ray& ray);
+    Color getAlbedo(IntersectionData& iData);
+    // huge page and NUMA interleave hints for the mesh arrays (see memoryPlacement.h)
+    void placeMemory(bool hugePages, bool interleave);
 
 };
 }
@@ -0,0 +1,34 @@
+#ifndef BLUENOISESAMPLER_H
+#define BLUENOISESAMPLER_H
+
+#include <kanima/sampler/sampler.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace krt
+{
+
+// Scrambled Sobol points that are the same for every pixel, shifted (modulo 1) by a
+// tiled blue noise mask. Neighbouring pixels get far apart shifts, so at low sample
+// counts the error looks like fine grain instead of clumps.
+class BlueNoiseSampler : public Sampler
+{
+private:
+    uint32_t seed;
+    int x, y;
+    uint32_t sampleIndex;
+
+public:
+    explicit BlueNoiseSampler(uint32_t seed);
+
+    void startSample(int x, int y, int sampleIndex) override;
+    void get2D(int dimension, uint32_t path, int split, int splitCount, float& u, float& v) override;
+
+    static const int MASK_SIZE = 64;
+    // values in (0, 1), built once by void-and-cluster
+    static const std::vector<float>& mask();
+};
+
+}
+#endif // BLUENOISESAMPLER_H
@@ -0,0 +1,63 @@
+#ifndef HEMISPHERE_H
+#define HEMISPHERE_H
+
+#include <kanima/linalg/vec3.h>
+
+#include <cmath>
+
+namespace krt
+{
+
+// Orthonormal basis around a unit normal, branchless (Duff et al., Building an
+// Orthonormal Basis, Revisited)
+struct Onb
+{
+    vec3 tangent;
+    vec3 bitangent;
+    vec3 normal;
+
+    explicit Onb(const vec3& n) : normal(n)
+    {
+        const float sign = std::copysign(1.0f, n.z);
+        const float a = -1.0f / (sign + n.z);
+        const float b = n.x * n.y * a;
+        tangent = vec3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+        bitangent = vec3(b, sign + n.y * n.y * a, -n.y);
+    }
+
+    vec3 toWorld(const vec3& local) const
+    {
+        return tangent * local.x + bitangent * local.y + normal * local.z;
+    }
+};
+
+// Cosine weighted direction around +z from a point of the unit square, pdf cos(theta) / pi.
+// The concentric disk mapping keeps strata of the square apart.
+inline vec3 sampleCosineHemisphere(float u, float v)
+{
+    const float a = 2.0f * u - 1.0f;
+    const float b = 2.0f * v - 1.0f;
+
+    float r = 0.0f;
+    float phi = 0.0f;
+    if (a != 0.0f || b != 0.0f)
+    {
+        if (std::abs(a) > std::abs(b))
+        {
+            r = a;
+            phi = static_cast<float>(M_PI / 4) * (b / a);
+        }
+        else
+        {
+            r = b;
+            phi = static_cast<float>(M_PI / 2) - static_cast<float>(M_PI / 4) * (a / b);
+        }
+    }
+
+    const float x = r * std::cos(phi);
+    const float y = r * std::sin(phi);
+    return vec3(x, y, std::sqrt(std::max(0.0f, 1.0f - x * x - y * y)));
+}
+
+}
+#endif // HEMISPHERE_H
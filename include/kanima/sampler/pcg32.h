@@ -0,0 +1,60 @@
+#ifndef PCG32_H
+#define PCG32_H
+
+#include <cstdint>
+
+namespace krt
+{
+
+// PCG32 generator (XSH RR output, 64 bit state), small enough to set up for every sample
+class Pcg32
+{
+private:
+    uint64_t state;
+    uint64_t inc;
+
+public:
+    Pcg32(uint64_t initState = 0x853c49e6748fea9bull, uint64_t initSeq = 0xda3e39cb94b95bdbull)
+    {
+        seed(initState, initSeq);
+    }
+
+    // initSeq picks one of 2^63 independent streams
+    void seed(uint64_t initState, uint64_t initSeq)
+    {
+        state = 0;
+        inc = (initSeq << 1u) | 1u;
+        nextUInt();
+        state += initState;
+        nextUInt();
+    }
+
+    uint32_t nextUInt()
+    {
+        uint64_t old = state;
+        state = old * 6364136223846793005ull + inc;
+        uint32_t xorShifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+        uint32_t rot = static_cast<uint32_t>(old >> 59u);
+        return (xorShifted >> rot) | (xorShifted << ((32 - rot) & 31));
+    }
+
+    // uniform in [0, 1)
+    float nextFloat()
+    {
+        return (nextUInt() >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+// 64 bit finalizer of MurmurHash3, for turning counters into seeds
+inline uint64_t mixBits(uint64_t v)
+{
+    v ^= v >> 33;
+    v *= 0xff51afd7ed558ccdull;
+    v ^= v >> 33;
+    v *= 0xc4ceb9fe1a85ec53ull;
+    v ^= v >> 33;
+    return v;
+}
+
+}
+#endif // PCG32_H
@@ -0,0 +1,29 @@
+#ifndef PCGSAMPLER_H
+#define PCGSAMPLER_H
+
+#include <kanima/sampler/sampler.h>
+#include <kanima/sampler/pcg32.h>
+
+#include <cstdint>
+
+namespace krt
+{
+
+// Independent uniform values from PCG32 streams keyed by pixel, sample and dimension,
+// one set of streams per seed
+class PcgSampler : public Sampler
+{
+private:
+    uint32_t seed;
+    uint64_t sampleKey;
+    Pcg32 rng;
+
+public:
+    explicit PcgSampler(uint32_t seed = 0);
+
+    void startSample(int x, int y, int sampleIndex) override;
+    void get2D(int dimension, uint32_t path, int split, int splitCount, float& u, float& v) override;
+};
+
+}
+#endif // PCGSAMPLER_H
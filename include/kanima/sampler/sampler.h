@@ -0,0 +1,79 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <cstdint>
+#include <memory>
+
+namespace krt
+{
+
+enum class SamplerType
+{
+    Independent, // PCG32 random numbers
+    Stratified,  // jittered strata over the samples of a pixel
+    Sobol,       // Owen scrambled Sobol points
+    BlueNoise    // Sobol points shifted per pixel by a blue noise mask
+};
+
+// Dimensions of a sample. A decision uses the same dimensions in every sample, so the
+// sampler can spread it out over the samples of the pixel.
+const int CAMERA_DIMENSION = 0;      // jitter inside the pixel
+const int FIRST_BOUNCE_DIMENSION = 2;
+const int DIMENSIONS_PER_BOUNCE = 4; // diffuse direction (2), russian roulette of the rays leaving (1), fresnel branch (1)
+
+// first dimension of the bounce at the hit of a ray with this pathDepth
+inline int bounceDimension(int pathDepth)
+{
+    return FIRST_BOUNCE_DIMENSION + DIMENSIONS_PER_BOUNCE * (pathDepth - 1);
+}
+
+// roulette of a ray with this pathDepth (> 1), drawn at the hit it leaves from
+inline int rouletteDimension(int pathDepth)
+{
+    return bounceDimension(pathDepth - 1) + 2;
+}
+
+// choice between refraction and reflection at the hit of a ray with this pathDepth
+inline int fresnelDimension(int pathDepth)
+{
+    return bounceDimension(pathDepth) + 3;
+}
+
+// path of the branch-th ray leaving a hit, so different branches get different values
+inline uint32_t branchPath(uint32_t path, int branch)
+{
+    uint32_t h = (path ^ 0x9e3779b9u) + static_cast<uint32_t>(branch + 1) * 0x85ebca6bu;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    return h;
+}
+
+// Random numbers of one pixel sample. The values depend only on the sampler's seed, the
+// pixel, the sample index and the arguments, so a render gives the same image with any
+// number of threads. Not thread safe, every render thread has its own.
+class Sampler
+{
+public:
+    virtual ~Sampler() = default;
+
+    virtual void startSample(int x, int y, int sampleIndex) = 0;
+
+    // Values in [0, 1) of a dimension pair of the current sample. path tells apart rays
+    // of different branches. Rays split off together at the same hit (gi_ray_count) pass
+    // their parent's path and their number, a sampler may stratify them among each other.
+    virtual void get2D(int dimension, uint32_t path, int split, int splitCount, float& u, float& v) = 0;
+
+    float get1D(int dimension, uint32_t path)
+    {
+        float u, v;
+        get2D(dimension, path, 0, 1, u, v);
+        return u;
+    }
+};
+
+// samplesPerPixel is the number of samples the strata are made for
+std::unique_ptr<Sampler> createSampler(SamplerType type, uint32_t seed, int samplesPerPixel);
+
+}
+#endif // SAMPLER_H
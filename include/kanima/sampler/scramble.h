@@ -0,0 +1,93 @@
+#ifndef SCRAMBLE_H
+#define SCRAMBLE_H
+
+#include <kanima/sampler/pcg32.h>
+
+#include <cstdint>
+
+namespace krt
+{
+
+inline uint32_t hashCombine(uint32_t seed, uint32_t value)
+{
+    return static_cast<uint32_t>(mixBits((static_cast<uint64_t>(seed) << 32) ^ value));
+}
+
+// 24 bit float in [0, 1)
+inline float toUnitFloat(uint32_t bits)
+{
+    return (bits >> 8) * (1.0f / 16777216.0f);
+}
+
+inline uint32_t reverseBits(uint32_t x)
+{
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+    x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+    x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+    x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+    return x;
+}
+
+// Owen scrambling of the bits of x by hashing (Burley, Practical Hash-based Owen Scrambling)
+inline uint32_t nestedUniformScramble(uint32_t x, uint32_t seed)
+{
+    x = reverseBits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return reverseBits(x);
+}
+
+// first two dimensions of the Sobol sequence, a (0, 2) sequence in base 2
+inline uint32_t sobolDimension0(uint32_t index)
+{
+    return reverseBits(index);
+}
+
+inline uint32_t sobolDimension1(uint32_t index)
+{
+    uint32_t result = 0;
+    for (uint32_t v = 1u << 31; index; index >>= 1, v ^= v >> 1)
+        if (index & 1)
+            result ^= v;
+    return result;
+}
+
+// element i of a pseudo random permutation of [0, length) (Kensler, Correlated Multi-Jittered Sampling)
+inline uint32_t permuteIndex(uint32_t i, uint32_t length, uint32_t seed)
+{
+    uint32_t w = length - 1;
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+    do
+    {
+        i ^= seed;
+        i *= 0xe170893du;
+        i ^= seed >> 16;
+        i ^= (i & w) >> 4;
+        i ^= seed >> 8;
+        i *= 0x0929eb3fu;
+        i ^= seed >> 23;
+        i ^= (i & w) >> 1;
+        i *= 1 | seed >> 27;
+        i *= 0x6935fa69u;
+        i ^= (i & w) >> 11;
+        i *= 0x74dcb303u;
+        i ^= (i & w) >> 2;
+        i *= 0x9e501cc3u;
+        i ^= (i & w) >> 2;
+        i *= 0xc860a3dfu;
+        i &= w;
+        i ^= i >> 5;
+    } while (i >= length);
+    return (i + seed) % length;
+}
+
+}
+#endif // SCRAMBLE_H
@@ -0,0 +1,33 @@
+#ifndef SOBOLSAMPLER_H
+#define SOBOLSAMPLER_H
+
+#include <kanima/sampler/sampler.h>
+
+#include <cstdint>
+
+namespace krt
+{
+
+// Padded Sobol points: every dimension pair takes the first two Sobol dimensions, with
+// a shuffled point order and Owen scrambling seeded per pixel, dimension and path, so
+// the pairs are independent of each other while each is well spread over the samples.
+// Split rays take consecutive points, sample * splitCount + split.
+class SobolSampler : public Sampler
+{
+private:
+    uint32_t seed;
+    uint32_t pixelKey;
+    uint32_t sampleIndex;
+
+public:
+    explicit SobolSampler(uint32_t seed);
+
+    void startSample(int x, int y, int sampleIndex) override;
+    void get2D(int dimension, uint32_t path, int split, int splitCount, float& u, float& v) override;
+
+    // point of the scrambled sequence, also used by the blue noise sampler
+    static void scrambledPoint(uint32_t index, uint32_t scrambleSeed, float& u, float& v);
+};
+
+}
+#endif // SOBOLSAMPLER_H
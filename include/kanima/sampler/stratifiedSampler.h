@@ -0,0 +1,30 @@
+#ifndef STRATIFIEDSAMPLER_H
+#define STRATIFIEDSAMPLER_H
+
+#include <kanima/sampler/sampler.h>
+
+#include <cstdint>
+
+namespace krt
+{
+
+// Jittered sampling: the samples of a pixel (times the split rays) fall into distinct
+// cells of a grid over each dimension pair, visited in a shuffled order. Samples beyond
+// samplesPerPixel are independent.
+class StratifiedSampler : public Sampler
+{
+private:
+    uint32_t seed;
+    int samplesPerPixel;
+    uint32_t pixelKey;
+    int sampleIndex;
+
+public:
+    StratifiedSampler(uint32_t seed, int samplesPerPixel);
+
+    void startSample(int x, int y, int sampleIndex) override;
+    void get2D(int dimension, uint32_t path, int split, int splitCount, float& u, float& v) override;
+};
+
+}
+#endif // STRATIFIEDSAMPLER_H
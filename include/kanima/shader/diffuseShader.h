@@ -4,10 +4,29 @@
 #include <kanima/core/color.h>
 #include <kanima/core/scene.h>
 #include <kanima/core/intersectionData.h>
+#include <kanima/sampler/sampler.h>
 
 namespace krt
 {
-Color diffuseShader(const Ray& ray, IntersectionData& intersectData, Scene& scene, int max_depth);
+Color diffuseShader(const Ray& ray, IntersectionData& intersectData, Scene& scene, int max_depth, Sampler& sampler);
+
+// mesh color times albedo
+Color diffuseReflectance(IntersectionData& intersectData, Scene& scene);
+
+// lights reaching the hit, through shadow rays
+Color diffuseDirectLight(IntersectionData& intersectData, Scene& scene, const Color& reflectance);
+
+// the pieces of diffuseDirectLight for one light: the shadow ray, which reaches the light
+// after distanceToLight, its test, and the light's share if nothing blocks it
+Ray shadowRay(IntersectionData& intersectData, const Light& light, double& distanceToLight);
+bool shadowRayBlocked(Scene& scene, const Ray& shadowRay, double distanceToLight);
+Color lightContribution(IntersectionData& intersectData, const Light& light, const Color& reflectance);
+
+// GI rays leaving a hit of the ray, 0 without global illumination
+int giRayCount(const Ray& ray, const Scene& scene);
+
+// i-th of rayCount GI rays, its throughput includes the reflectance and the 1 / rayCount
+Ray giRay(const Ray& ray, IntersectionData& intersectData, const Color& reflectance, int i, int rayCount, Sampler& sampler);
 
 }
 
@@ -0,0 +1,19 @@
+#ifndef ITERATIVESHADER_H
+#define ITERATIVESHADER_H
+
+#include <kanima/core/ray.h>
+#include <kanima/core/color.h>
+#include <kanima/core/scene.h>
+#include <kanima/sampler/sampler.h>
+
+namespace krt
+{
+// Same image as recursiveShader, but the bounces of a path run in a loop. Each ray
+// carries its weight in the pixel as throughput, so a hit adds throughput times its own
+// light and hands the ray on. Extra rays of refraction and GI splits wait on a stack.
+Color iterativeShader(const Ray &ray, Scene& scene, int max_depth, Sampler& sampler);
+// the same for a ray whose hit is traced already, like a camera ray of a packet
+Color iterativeShader(const Ray &ray, const IntersectionData& hit, Scene& scene, int max_depth, Sampler& sampler);
+}
+
+#endif // ITERATIVESHADER_H
@@ -4,6 +4,7 @@
 #include <kanima/core/ray.h>
 #include <kanima/core/color.h>
 #include <kanima/core/scene.h>
+#include <kanima/sampler/sampler.h>
 #include <kanima/shader/constantShader.h>
 #include <kanima/shader/diffuseShader.h>
 #include <kanima/shader/reflectiveShader.h>
@@ -11,7 +12,19 @@
 
 namespace krt
 {
-Color recursiveShader(const Ray &ray, Scene& scene, int max_depth);
+Color recursiveShader(const Ray &ray, Scene& scene, int max_depth, Sampler& sampler);
+// the same for a ray whose hit is traced already, like a camera ray of a packet
+Color recursiveShader(const Ray &ray, const IntersectionData& hit, Scene& scene, int max_depth, Sampler& sampler);
+
+// color of a traced hit of the ray (the background if there is none), the part of
+// recursiveShader after the depth, roulette and trace steps
+Color shadeHit(const Ray& ray, IntersectionData& iData, Scene& scene, int max_depth, Sampler& sampler);
+
+// Russian roulette. Paths below rr_min_throughput survive with the probability
+// throughput / rr_min_throughput, past rr_start_depth the others with their throughput.
+// A surviving path's throughput is divided by survival, so the estimate stays unbiased.
+// False when the path ends.
+bool continuePath(const Ray& ray, const Scene& scene, Sampler& sampler, float& survival);
 }
 
 #endif // RECURSIVESHADER_H
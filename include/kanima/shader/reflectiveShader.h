@@ -3,10 +3,14 @@
 
 #include <kanima/core/color.h>
 #include <kanima/core/scene.h>
+#include <kanima/sampler/sampler.h>
 
 namespace krt
 {
-Color reflectiveShader(const Ray& ray, IntersectionData& intersectData, Scene& scene, int max_depth);
+Color reflectiveShader(const Ray& ray, IntersectionData& intersectData, Scene& scene, int max_depth, Sampler& sampler);
+
+// reflection of the ray at the hit, its throughput includes the albedo
+Ray mirrorRay(const Ray& ray, IntersectionData& intersectData, const Color& albedo);
 }
 
 #endif // REFLECTIVESHADER_H
@@ -3,11 +3,16 @@
 
 #include <kanima/core/color.h>
 #include <kanima/core/scene.h>
+#include <kanima/sampler/sampler.h>
 
 namespace krt
 {
 
-Color refractiveShader(const Ray& ray, IntersectionData& intersectData, Scene& scene, int max_depth);
+Color refractiveShader(const Ray& ray, IntersectionData& intersectData, Scene& scene, int max_depth, Sampler& sampler);
+
+// Rays leaving a refractive hit, returns their number (1 or 2). The hit's color is the
+// weighted sum of theirs; the throughputs already include the weights.
+int refractiveRays(const Ray& ray, IntersectionData& intersectData, Scene& scene, Sampler& sampler, Ray rays[2], float weights[2]);
 
 }
 #endif // REFRACTIVESHADER_H
@@ -0,0 +1,33 @@
+#ifndef WAVEFRONTSHADER_H
+#define WAVEFRONTSHADER_H
+
+#include <kanima/core/ray.h>
+#include <kanima/core/color.h>
+#include <kanima/core/scene.h>
+#include <kanima/sampler/sampler.h>
+
+#include <vector>
+
+namespace krt
+{
+// one camera sample of a pixel
+struct PixelSample
+{
+    int x, y, sample;
+};
+
+// Shades many camera samples together, one stage at a time: a chunk of up to 4096 rays
+// of a generation is traced, the hits are grouped by material and each group is shaded
+// in its own loop, which fills the queue of the next generation. The shadow rays of the
+// diffuse hits are traced as a queue of their own. The deepest queue is always drained
+// first, so each generation after the camera rays holds at most the children of one
+// chunk, 4096 * max(gi_ray_count, 2) rays, at any depth. colors[i] gets the color of
+// cameraRays[i], taken for samples[i]; the image is the one of iterativeShader. With
+// cameraPackets the camera rays are traced in packets of RAY_PACKET_SIZE neighbours
+// (see Scene::tracePacketBVH).
+void wavefrontShader(const std::vector<Ray>& cameraRays, const std::vector<PixelSample>& samples,
+                     Scene& scene, int max_depth, Sampler& sampler, std::vector<Color>& colors,
+                     bool cameraPackets = false);
+}
+
+#endif // WAVEFRONTSHADER_H
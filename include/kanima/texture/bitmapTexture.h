@@ -1,54 +1,57 @@
 #ifndef BITMAPTEXTURE_H
 #define BITMAPTEXTURE_H
 
-#include <kanima/stb_image/stb_image.h>
 #include <kanima/texture/texture.h>
+#include <kanima/texture/imageCache.h>
 
-#include <unistd.h>
-#include <iostream>
+#include <memory>
 
 namespace krt
 {
 
 class BitmapTexture : public Texture {
 private:
-    int width, height, channels;
-    unsigned char* data;
+    std::shared_ptr<const BitmapImage> image;
+    BitmapImageFuture pendingImage;
 
 public:
+    // decodes the file immediately
     BitmapTexture(const std::string& name, const std::string& filename)
         : Texture(name, "bitmap") {
 
-        std::string fixedPath = filename;
+        image = BitmapImage::load(fixPath(filename));
+    }
 
-        if (!filename.empty() && filename[0] == '/')
-        {
-            fixedPath = filename.substr(1); // removes leading '/'
-        }
+    // image decoded in the background (see ImageCache). Call waitForImage() before rendering,
+    // after ImageCache::wait() on a pool thread, since it blocks without running tasks.
+    BitmapTexture(const std::string& name, const BitmapImageFuture& futureImage)
+        : Texture(name, "bitmap"), pendingImage(futureImage) {}
 
-        data = stbi_load(fixedPath.c_str(), &width, &height, &channels, 3); // force 3 channels (RGB)
-        if (!data)
+    static std::string fixPath(const std::string& filename)
+    {
+        if (!filename.empty() && filename[0] == '/')
         {
-            std::cerr << "Failed to load texture image: " << filename << std::endl;
-            char buffer[1024];
-            if (getcwd(buffer, sizeof(buffer)) != NULL)
-                std::cout << "CWD: " << buffer << std::endl;
-            else
-                perror("getcwd() error");
-
-            width = height = channels = 0;
+            return filename.substr(1); // removes leading '/'
         }
+        return filename;
     }
 
-    ~BitmapTexture()
+    void waitForImage()
     {
-        if (data)
+        if (!image && pendingImage.valid())
         {
-            stbi_image_free(data);
+            image = pendingImage.get();
         }
     }
 
     Color getTextureAlbedo(float u, float v, const BaryCoord& point) const override {
+        const BitmapImage* img = image ? image.get() : (pendingImage.valid() ? pendingImage.get().get() : nullptr);
+        if (!img || !img->data)
+            return Color(0, 0, 0);
+
+        const int width = img->width;
+        const int height = img->height;
+
         // Convert to pixel coords
         int x = static_cast<int>(u * width);
         int y = static_cast<int>((1.0f - v) * height); // flip v since images are top-down
@@ -57,11 +60,11 @@ public:
         x = std::min(std::max(x, 0), width - 1);
         y = std::min(std::max(y, 0), height - 1);
 
-        int index = (y * width + x) * channels;
+        int index = (y * width + x) * img->channels;
 
-        float r = data[index] / 255.0f;
-        float g = data[index + 1] / 255.0f;
-        float b = data[index + 2] / 255.0f;
+        float r = img->data[index] / 255.0f;
+        float g = img->data[index + 1] / 255.0f;
+        float b = img->data[index + 2] / 255.0f;
 
         return Color(r, g, b);
     }
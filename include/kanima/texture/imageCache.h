@@ -0,0 +1,65 @@
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include <kanima/util/threadPool.h>
+
+#include <string>
+#include <memory>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+namespace krt
+{
+
+// decoded RGB pixels of an image file, freed with the last reference
+class BitmapImage
+{
+public:
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    unsigned char* data = nullptr;
+
+    BitmapImage() = default;
+    ~BitmapImage();
+
+    BitmapImage(const BitmapImage&) = delete;
+    BitmapImage& operator=(const BitmapImage&) = delete;
+
+    // synchronous stbi_load, forced to 3 channels. Returns an empty image on failure.
+    static std::shared_ptr<const BitmapImage> load(const std::string& filePath);
+};
+
+typedef std::shared_future<std::shared_ptr<const BitmapImage>> BitmapImageFuture;
+
+// Decodes images as thread pool tasks and keeps them by path, so textures
+// that reference the same file share one pixel buffer.
+class ImageCache
+{
+private:
+    std::mutex mtx;
+    std::unordered_map<std::string, BitmapImageFuture> images;
+    ThreadPool* pool;
+    ThreadPool::TaskGroup decodes;
+
+public:
+    // without a pool the first request picks currentThreadPool()
+    ImageCache();
+    explicit ImageCache(ThreadPool& pool);
+    ~ImageCache();
+
+    ImageCache(const ImageCache&) = delete;
+    ImageCache& operator=(const ImageCache&) = delete;
+
+    // starts decoding the file if it is not cached yet, returns immediately
+    BitmapImageFuture request(const std::string& filePath);
+
+    // blocks until every requested image is decoded
+    void wait();
+
+    void clear();
+};
+
+}
+#endif // IMAGECACHE_H
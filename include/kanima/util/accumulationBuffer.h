@@ -0,0 +1,106 @@
+#ifndef ACCUMULATIONBUFFER_H
+#define ACCUMULATIONBUFFER_H
+
+#include <kanima/core/color.h>
+#include <kanima/util/pixelBuffer.h>
+
+#include <vector>
+#include <cassert>
+#include <iostream>
+
+namespace krt
+{
+
+// Running sum and sample count per pixel, for progressive rendering
+class AccumulationBuffer
+{
+private:
+    int width;
+    int height;
+    std::vector<Color> sum;
+    std::vector<float> sumSquaredLuminance;
+    std::vector<int> count;
+
+public:
+    AccumulationBuffer(int w, int h) : width(w), height(h), sum(w * h, Color(0, 0, 0)), sumSquaredLuminance(w * h, 0.0f), count(w * h, 0) {}
+
+    static float luminance(const Color& c)
+    {
+        return 0.2126f * c.r + 0.7152f * c.g + 0.0722f * c.b;
+    }
+
+    void addSample(int x, int y, const Color& color)
+    {
+        assert (x >= 0 && x < width && y >= 0 && y < height);
+        float l = luminance(color);
+        sum[y * width + x] = sum[y * width + x] + color;
+        sumSquaredLuminance[y * width + x] += l * l;
+        count[y * width + x]++;
+    }
+
+    // mean of the samples so far, black without samples
+    Color getColor(int x, int y) const
+    {
+        assert (x >= 0 && x < width && y >= 0 && y < height);
+        int n = count[y * width + x];
+        return n > 0 ? sum[y * width + x] * (1.0f / n) : Color(0, 0, 0);
+    }
+
+    int getSampleCount(int x, int y) const
+    {
+        assert (x >= 0 && x < width && y >= 0 && y < height);
+        return count[y * width + x];
+    }
+
+    // sample variance of the luminance, 0 with fewer than two samples
+    float getLuminanceVariance(int x, int y) const
+    {
+        assert (x >= 0 && x < width && y >= 0 && y < height);
+        int n = count[y * width + x];
+        if (n < 2)
+            return 0.0f;
+
+        float mean = luminance(sum[y * width + x]) / n;
+        float variance = (sumSquaredLuminance[y * width + x] - n * mean * mean) / (n - 1);
+        return variance > 0.0f ? variance : 0.0f;
+    }
+
+    PixelBuffer toPixelBuffer() const
+    {
+        PixelBuffer buffer(width, height);
+        for (int y = 0; y < height; ++y)
+            for (int x = 0; x < width; ++x)
+                buffer.setColor(x, y, getColor(x, y));
+        return buffer;
+    }
+
+    // raw sums and counts, the layout of a checkpoint
+    bool write(std::ostream& out) const
+    {
+        out.write(reinterpret_cast<const char*>(sum.data()), sum.size() * sizeof(Color));
+        out.write(reinterpret_cast<const char*>(sumSquaredLuminance.data()), sumSquaredLuminance.size() * sizeof(float));
+        out.write(reinterpret_cast<const char*>(count.data()), count.size() * sizeof(int));
+        return static_cast<bool>(out);
+    }
+
+    bool read(std::istream& in)
+    {
+        in.read(reinterpret_cast<char*>(&sum[0]), sum.size() * sizeof(Color));
+        in.read(reinterpret_cast<char*>(&sumSquaredLuminance[0]), sumSquaredLuminance.size() * sizeof(float));
+        in.read(reinterpret_cast<char*>(&count[0]), count.size() * sizeof(int));
+        return static_cast<bool>(in);
+    }
+
+    int getWidth() const
+    {
+        return width;
+    }
+
+    int getHeight() const
+    {
+        return height;
+    }
+};
+
+}
+#endif // ACCUMULATIONBUFFER_H
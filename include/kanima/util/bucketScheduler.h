@@ -0,0 +1,95 @@
+#ifndef BUCKETSCHEDULER_H
+#define BUCKETSCHEDULER_H
+
+#include <vector>
+#include <atomic>
+#include <memory>
+
+namespace krt
+{
+
+struct Bucket
+{
+    int x, y, width, height;
+};
+
+enum class BucketOrder
+{
+    RowMajor,
+    Hilbert, // consecutive buckets are mostly neighbours; the curve covers the next power-of-two
+             // grid and skips its cells outside the image, which can jump
+    Spiral   // outwards from the image center, so the middle of a preview shows up first
+};
+
+// Buckets of one render. The bucket list is built up front in the requested order
+// and cut into one contiguous run per worker. A worker takes buckets from its own
+// run with a fetch-add, so it keeps working on neighbouring tiles, and moves on to
+// the run with the most buckets left once its own is empty.
+// Buckets are rendered row by row and every row is claimed with a fetch-add on the
+// bucket's row counter. Once no bucket is left to start, idle workers join the
+// started bucket with the most rows left, so the last expensive buckets of a frame
+// are shared instead of finished by one thread. No locks are taken.
+// One scheduler per render, which lets several renders run in the same process.
+class BucketScheduler
+{
+private:
+    struct Run
+    {
+        std::atomic<int> next;
+        int end;
+    };
+
+    struct BucketState
+    {
+        std::atomic<bool> started;
+        std::atomic<int> nextRow;  // offset from the bucket's y
+        std::atomic<int> rowsDone;
+    };
+
+    std::vector<Bucket> buckets;
+    std::vector<int> active; // buckets of the current pass, in the order they are handed out
+    std::unique_ptr<BucketState[]> states;
+    std::unique_ptr<Run[]> runs;
+    int runCount;
+    std::atomic<int> activeBuckets; // active.size(), for readers outside the workers
+    std::atomic<int> completedBuckets;
+
+public:
+    BucketScheduler(int imageWidth, int imageHeight, int bucketSize,
+                    BucketOrder order = BucketOrder::RowMajor, int numWorkers = 1);
+
+    BucketScheduler(const BucketScheduler&) = delete;
+    BucketScheduler& operator=(const BucketScheduler&) = delete;
+
+    // Starts the next bucket. run is the worker's current run, start with the worker
+    // index. It is moved to another run when the current one is empty.
+    // False once all buckets are started.
+    bool next(int& bucketIdx, int& run);
+
+    // a started bucket that still has rows to claim, false if there is none
+    bool steal(int& bucketIdx);
+
+    // starts over with every bucket unstarted, only while no worker uses the scheduler
+    void reset();
+    // starts over with only the given buckets, handed out in that order
+    void reset(const std::vector<int>& bucketIndices);
+
+    // claims the next row of the bucket, false when all rows are claimed
+    bool claimRow(int bucketIdx, int& y);
+
+    // true when this was the last row of the bucket
+    bool finishRow(int bucketIdx);
+
+    const Bucket& bucket(int bucketIdx) const { return buckets[bucketIdx]; }
+    int bucketCount() const { return static_cast<int>(buckets.size()); }
+    int activeCount() const { return activeBuckets.load(); }
+    int completedCount() const { return completedBuckets.load(); }
+    // fraction of the active buckets completed, safe to read while reset() runs
+    float progress() const;
+
+    // bucket order over a grid of tilesX x tilesY tiles, as (x, y) tile coordinates
+    static std::vector<std::pair<int, int>> tileOrder(int tilesX, int tilesY, BucketOrder order);
+};
+
+}
+#endif // BUCKETSCHEDULER_H
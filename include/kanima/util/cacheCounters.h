@@ -0,0 +1,34 @@
+#ifndef CACHECOUNTERS_H
+#define CACHECOUNTERS_H
+
+#include <cstdint>
+
+namespace krt
+{
+
+// Hardware cache reference and miss counts of the calling thread (Linux perf events,
+// user space only). Counting is unavailable when the kernel or a VM does not expose
+// the counters, then start() returns false and the counts stay zero.
+class CacheCounters
+{
+private:
+    int referencesFd;
+    int missesFd;
+
+public:
+    uint64_t references = 0;
+    uint64_t misses = 0;
+
+    CacheCounters();
+    ~CacheCounters();
+
+    CacheCounters(const CacheCounters&) = delete;
+    CacheCounters& operator=(const CacheCounters&) = delete;
+
+    bool start();
+    // adds the counts since start() to references and misses
+    void stop();
+};
+
+}
+#endif // CACHECOUNTERS_H
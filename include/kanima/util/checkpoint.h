@@ -0,0 +1,34 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <kanima/util/accumulationBuffer.h>
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+namespace krt
+{
+
+struct CheckpointInfo
+{
+    uint64_t configHash = 0; // settings and scene the samples depend on
+    uint32_t seed = 0;
+    int passes = 0;          // completed passes, the next one continues from here
+};
+
+// Progressive render state in a binary file: magic, version, size, CheckpointInfo and the
+// AccumulationBuffer sums and counts. The file is written next to its name and renamed,
+// so a render stopped while writing keeps the previous checkpoint. A failed write
+// removes the temporary file.
+bool writeCheckpoint(const std::string& fileName, const AccumulationBuffer& accumulation, const CheckpointInfo& info);
+
+// Reads a checkpoint of a width x height image with the configHash and seed of expected.
+// nullptr if the file is missing, truncated, of another version or of other settings;
+// otherSettings tells the last case apart. The header is checked before the buffer is
+// allocated, so a foreign file cannot ask for an arbitrary size.
+std::unique_ptr<AccumulationBuffer> readCheckpoint(const std::string& fileName, int width, int height,
+                                                   const CheckpointInfo& expected, CheckpointInfo& info, bool& otherSettings);
+
+}
+#endif // CHECKPOINT_H
@@ -0,0 +1,34 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <cstddef>
+
+namespace krt
+{
+
+// Read-only memory mapping of a whole file. The mapping is released on destruction.
+class MappedFile
+{
+private:
+    const char* data;
+    size_t length;
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& fileName);
+    void close();
+
+    bool isOpen() const { return data != nullptr; }
+    const char* begin() const { return data; }
+    const char* end() const { return data + length; }
+    size_t size() const { return length; }
+};
+
+}
+#endif // MAPPEDFILE_H
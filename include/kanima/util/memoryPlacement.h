@@ -0,0 +1,34 @@
+#ifndef MEMORYPLACEMENT_H
+#define MEMORYPLACEMENT_H
+
+#include <vector>
+#include <cstddef>
+
+namespace krt
+{
+
+// Linux only hints for large read-mostly arrays, no-ops elsewhere. Ranges smaller
+// than a huge page are left alone. Both return false when nothing was changed.
+
+// transparent huge pages for the whole 2 MB pages inside the range
+bool adviseHugePages(const void* data, size_t bytes);
+
+// spreads the pages of the range round robin over all NUMA nodes, moving pages
+// that are already placed. Does nothing on a single node machine.
+bool interleaveAcrossNodes(const void* data, size_t bytes);
+
+int numaNodeCount();
+
+template <typename T>
+void placeArray(const std::vector<T>& v, bool hugePages, bool interleave)
+{
+    if (v.empty())
+        return;
+    if (hugePages)
+        adviseHugePages(v.data(), v.size() * sizeof(T));
+    if (interleave)
+        interleaveAcrossNodes(v.data(), v.size() * sizeof(T));
+}
+
+}
+#endif // MEMORYPLACEMENT_H
@@ -0,0 +1,22 @@
+#ifndef MULTIPROCESSRENDER_H
+#define MULTIPROCESSRENDER_H
+
+#include <kanima/util/renderScene.h>
+
+namespace krt
+{
+
+// Renders with numProcesses forked worker processes on this machine (<= 0 uses one per
+// cpu). The calling process prepares the scene, so the workers share the loaded scene and
+// its BVH copy-on-write, and acts as coordinator: it hands out one bucket at a time over
+// a Unix socket pair per worker and merges the returned tiles into the image. Buckets of
+// a worker that dies, or takes longer than config.tile_timeout_seconds for one, are handed
+// to the others. If no worker is left, the remaining buckets stay black and are counted
+// in stats->bucketsLost, so check it before trusting the image. The workers render on a
+// single thread each and ignore progressive mode. Linux only; no other render may be
+// running in the process while the workers are forked.
+PixelBuffer renderSceneMultiProcess(Scene& scene, RenderConfig& config, int numProcesses, RenderStats* stats = nullptr);
+PixelBuffer renderSceneMultiProcess(RenderContext& context, Scene& scene, RenderConfig& config, int numProcesses, RenderStats* stats = nullptr);
+
+}
+#endif // MULTIPROCESSRENDER_H
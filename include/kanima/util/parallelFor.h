@@ -0,0 +1,17 @@
+#ifndef PARALLELFOR_H
+#define PARALLELFOR_H
+
+#include <functional>
+
+namespace krt
+{
+
+// Runs body(i) for every i in [begin, end) as up to numThreads tasks of the current
+// thread pool (see currentThreadPool). Indices are handed out one at a time, so body
+// should do a chunk of work per call. numThreads <= 0 uses every worker.
+void parallelFor(int begin, int end, int numThreads, const std::function<void(int)>& body);
+
+int defaultThreadCount();
+
+}
+#endif // PARALLELFOR_H
@@ -62,6 +62,11 @@ public:
         return height;
     }
 
+    const Color* data() const
+    {
+        return buffer.data();
+    }
+
 };
 
 }
@@ -0,0 +1,33 @@
+#ifndef RENDERCONTEXT_H
+#define RENDERCONTEXT_H
+
+#include <kanima/util/threadPool.h>
+
+namespace krt
+{
+
+// Long-lived state shared by renders, scene loading and BVH builds. Keeping one
+// context around between frames keeps its worker threads alive.
+class RenderContext
+{
+private:
+    ThreadPool threadPool;
+
+public:
+    // numWorkers <= 0 sizes the pool from the hardware concurrency
+    explicit RenderContext(int numWorkers = 0);
+
+    RenderContext(const RenderContext&) = delete;
+    RenderContext& operator=(const RenderContext&) = delete;
+
+    ThreadPool& pool() { return threadPool; }
+
+    // used by the calls that do not take a context
+    static RenderContext& defaultContext();
+};
+
+// the pool bound to the calling thread, otherwise the default context's pool
+ThreadPool& currentThreadPool();
+
+}
+#endif // RENDERCONTEXT_H
@@ -4,6 +4,12 @@
 #include <kanima/util/pixelBuffer.h>
 #include <kanima/core/scene.h>
 #include <kanima/shader/recursiveShader.h>
+#include <kanima/shader/iterativeShader.h>
+#include <kanima/shader/wavefrontShader.h>
+#include <kanima/util/renderContext.h>
+#include <kanima/util/bucketScheduler.h>
+#include <kanima/util/accumulationBuffer.h>
+#include <kanima/sampler/sampler.h>
 
 #include <iostream>
 #include <string>
@@ -12,11 +18,22 @@
 #include <queue>
 #include <chrono>
 #include <cstdlib>
+#include <cstdint>
+#include <memory>
+#include <functional>
+#include <vector>
 
 
 namespace krt
 {
 
+enum class Integrator
+{
+    Recursive, // the shaders call each other for every bounce
+    Iterative, // bounces in a loop, see iterativeShader
+    Wavefront  // the samples of several rows at once, stage by stage, see wavefrontShader
+};
+
 struct RenderConfig
 {
     bool use_BVH = true;
@@ -26,15 +43,168 @@ struct RenderConfig
     int min_triangles_per_leaf = 4;
     int buffer_width = 1280;
     int buffer_height = 720;
-    int num_threads = 8;
+    int num_threads = 8; // render tasks on the context's pool, <= 0 uses every worker
     int bucket_size = 24;
+    BucketOrder bucket_order = BucketOrder::Hilbert;
     int ray_depth = 5;
     int gi_ray_count = 0;
+    // Split traces gi_ray_count rays at every diffuse hit. PrimarySplit does so only at
+    // the first diffuse hit of a path and Path never (gi_ray_count > 0 turns GI on), the
+    // rays after that continue one per bounce, so the cost grows linearly with ray_depth.
+    GIMode gi_mode = GIMode::Split;
     int sample_per_pixel = 1;
+    Integrator integrator = Integrator::Iterative;
+    // camera rays of RAY_PACKET_SIZE neighbouring samples are traced together (BVH only)
+    bool primary_ray_packets = true;
+
+    // Rays deeper than rr_start_depth continue with a probability of their throughput
+    // (0 turns this off). Paths below rr_min_throughput go through the same roulette at
+    // any depth, the surviving ones are raised to rr_min_throughput (0 turns it off).
+    int rr_start_depth = 3;
+    float rr_min_throughput = 1e-3f;
+
+    // Refractive hits of rays up to this path depth trace both the refraction and the
+    // reflection ray (1 is the camera ray's hit). Deeper hits follow one of them, picked
+    // with its Fresnel weight, so rays per sample grow linearly with ray_depth.
+    int fresnel_branch_depth = 1;
+
+    // Out-of-core geometry: after the BVH is built the triangles move to a page file and
+    // only page_cache_mb of them are kept in memory. Needs the BVH and stays on for the scene.
+    bool paged_geometry = false;
+    std::string geometry_page_file = "kanima_geometry.pages";
+    int page_cache_mb = 256;
+    int triangles_per_page = 4096;
+
+    // hardware cache counters around the render tasks, see RenderStats
+    bool count_cache_misses = false;
+
+    // Placement for multi-socket machines. pin_threads pins the pool workers to one cpu
+    // each; they stay pinned for later renders on the context until
+    // context.pool().pinWorkers(false). numa_interleave spreads the mesh arrays and the
+    // pixel buffer over all NUMA nodes, huge_pages asks for transparent huge pages for
+    // them. Linux only.
+    bool pin_threads = false;
+    bool numa_interleave = false;
+    bool huge_pages = false;
+
+    // Progressive mode renders sample_per_pixel passes over the whole image, one sample
+    // per pixel each, into an AccumulationBuffer. on_pass_complete gets the number of
+    // passes done. on_tile_complete runs on the render threads while other tiles are
+    // still being written.
+    bool progressive = false;
+    std::function<void(const AccumulationBuffer&, int)> on_pass_complete;
+    std::function<void(const AccumulationBuffer&, const Bucket&)> on_tile_complete;
+
+    // Seconds for the whole render including setup, 0 for no limit. Renders progressively
+    // until the budget is spent, ignoring sample_per_pixel: two passes over every tile,
+    // then passes over the noisier half of the tiles, noisiest first. The first pass is
+    // always completed. RenderStats::regionSamples reports the samples each tile got.
+    double time_budget_seconds = 0;
+
+    // Adaptive sampling renders in rounds. Each round adds sample_per_pixel samples (at
+    // least 2) to every pixel whose 95% confidence interval of the luminance mean is still
+    // wider than adaptive_threshold times the mean, until max_spp samples. Only tiles with
+    // such pixels are scheduled again, the ones with the most first. Takes precedence over
+    // progressive mode; on_pass_complete is called after each round.
+    bool adaptive_sampling = false;
+    float adaptive_threshold = 0.05f;
+    int max_spp = 256;
+
+    // Random numbers depend only on the seed, the pixel and its sample number, so the
+    // image is the same for any num_threads. Stratified sampling is made for
+    // sample_per_pixel samples, max_spp with adaptive sampling.
+    SamplerType sampler = SamplerType::Sobol;
+    uint32_t seed = 0;
+
+    // Checkpoints of progressive renders, written at the end of a pass once
+    // checkpoint_interval_seconds have passed since the last one, and after the last pass.
+    // resume_checkpoint continues from checkpoint_file if it exists; a checkpoint of other
+    // settings cancels the render. Setting checkpoint_file turns on progressive mode.
+    std::string checkpoint_file;
+    double checkpoint_interval_seconds = 600;
+    bool resume_checkpoint = false;
+
+    // Multi-process renders (see multiProcessRender.h): a worker that has not returned
+    // its tile after this many seconds is killed and the tile handed to the others.
+    // 0 waits forever.
+    double tile_timeout_seconds = 600;
 };
 
+struct RegionSamples
+{
+    Bucket region;
+    int minSamples;
+    int maxSamples;
+    float meanSamples;
+};
+
+struct RenderStats
+{
+    double renderSeconds = 0;
+    bool cacheCountersAvailable = false;
+    uint64_t cacheReferences = 0;
+    uint64_t cacheMisses = 0;
+    uint64_t raysTraced = 0; // camera, secondary and shadow rays
 
+    // progressive, time budget and adaptive renders only
+    int passes = 0;
+    int resumedPasses = 0; // passes read from the checkpoint
+    std::vector<RegionSamples> regionSamples;
+
+    // multi-process renders only: buckets left black because every worker was lost
+    int bucketsLost = 0;
+};
+
+
+struct RenderJobState;
+
+// Handle of a render started with renderSceneAsync. Copies refer to the same render.
+// The scene must stay alive, and must not be rendered otherwise, until the render is done.
+class RenderHandle
+{
+private:
+    std::shared_ptr<RenderJobState> job;
+
+public:
+    explicit RenderHandle(std::shared_ptr<RenderJobState> job);
+
+    // fraction of finished buckets
+    float progress() const;
+    bool isDone() const;
+
+    // the calling thread runs render tasks while it waits
+    void wait();
+
+    // waits, a cancelled render returns the buckets finished so far
+    const PixelBuffer& get();
+    RenderStats stats();
+
+    // render tasks stop before their next bucket
+    void cancel();
+    bool isCancelled() const;
+
+    // paused renders keep no pool thread busy, resume() hands the rest back to the pool
+    void pause();
+    void resume();
+    bool isPaused() const;
+};
+
+// returns at once, the render runs as tasks of the context's pool
+RenderHandle renderSceneAsync(Scene& scene, RenderConfig& config);
+RenderHandle renderSceneAsync(RenderContext& context, Scene& scene, RenderConfig& config);
+
+// renders on the default context
 PixelBuffer renderSceneToBuffer(Scene& scene, RenderConfig& config);
 
+// renders on the context's thread pool. Reusing a context for many frames avoids
+// starting and stopping threads for each of them.
+PixelBuffer renderSceneToBuffer(RenderContext& context, Scene& scene, RenderConfig& config, RenderStats* stats = nullptr);
+
+// For renderers that hand out buckets themselves: the scene setup of a render (BVH,
+// geometry paging, memory placement), then one bucket at a time on the calling thread.
+// renderBucket returns a bucket sized buffer and ignores progressive mode.
+void prepareSceneForRender(RenderContext& context, Scene& scene, const RenderConfig& config);
+PixelBuffer renderBucket(Scene& scene, const RenderConfig& config, const Bucket& bucket);
+
 }
 #endif // RENDERSCENE_H
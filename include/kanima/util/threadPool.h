@@ -0,0 +1,113 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace krt
+{
+
+// Persistent workers with one task deque each. A worker pushes and pops its own
+// tasks at the back and steals from the front of the others. Threads that wait
+// on a TaskGroup run queued tasks meanwhile, so tasks can submit and wait on
+// further tasks without blocking a worker.
+class ThreadPool
+{
+public:
+    // tasks submitted with the same group are waited on together
+    class TaskGroup
+    {
+    private:
+        friend class ThreadPool;
+        std::atomic<int> pending;
+
+    public:
+        TaskGroup() : pending(0) {}
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        bool done() const { return pending.load() == 0; }
+    };
+
+    // makes the pool current() for the calling thread until destroyed
+    class Binding
+    {
+    private:
+        ThreadPool* previous;
+
+    public:
+        explicit Binding(ThreadPool& pool);
+        ~Binding();
+
+        Binding(const Binding&) = delete;
+        Binding& operator=(const Binding&) = delete;
+    };
+
+private:
+    struct Task
+    {
+        std::function<void()> fn;
+        TaskGroup* group;
+    };
+
+    struct TaskQueue
+    {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+    };
+
+    // one queue per worker, the last one takes tasks from outside threads
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex mtx;
+    std::condition_variable wakeup;
+    std::atomic<int> queuedTasks;
+    bool stopping = false;
+
+    std::vector<int> allowedCpus; // affinity of the thread that created the pool
+    std::mutex affinityMtx;       // renders sharing the pool pin it concurrently
+    bool pinned = false;
+
+    void workerLoop(int workerIdx);
+    bool popTask(int workerIdx, Task& task);
+    void runTask(Task& task);
+    int callerQueue() const;
+
+public:
+    // numWorkers <= 0 uses one less than the hardware concurrency, since the
+    // thread waiting on a group works as well
+    explicit ThreadPool(int numWorkers = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int workerCount() const { return static_cast<int>(workers.size()); }
+
+    // Pins worker i to the i-th cpu the pool may run on (wrapping around), or gives
+    // every worker all of them again. Linux only, returns false if nothing changed.
+    bool pinWorkers(bool pin);
+
+    void submit(TaskGroup& group, std::function<void()> fn);
+
+    // returns once every task of the group has run, running queued tasks meanwhile
+    void wait(TaskGroup& group);
+
+    // body(i) for every i in [begin, end), split over at most maxTasks tasks
+    // (<= 0 uses every worker plus the calling thread)
+    void parallelFor(int begin, int end, const std::function<void(int)>& body, int maxTasks = 0);
+
+    // the pool bound to the calling thread (its own pool for a worker), or nullptr
+    static ThreadPool* bound();
+};
+
+}
+#endif // THREADPOOL_H
@@ -0,0 +1,88 @@
+#include <kanima/core/scene.h>
+#include <kanima/util/renderScene.h>
+#include <kanima/util/pixelBuffer.h>
+
+#include "bufferCompare.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+// An adaptive render resets the scheduler to fewer tiles after every round. progress()
+// is polled all the while and must stay in [0, 1], and end at 1 although every pixel
+// converges before max_spp. The image must match a single threaded render, since a
+// pixel's samples and stopping point are its own.
+int main()
+{
+    krt::Scene scene("dragon.crtscene");
+
+    krt::RenderConfig config;
+    config.buffer_width = 96;
+    config.buffer_height = 54;
+    config.bucket_size = 12;
+    config.ray_depth = 3;
+    config.gi_ray_count = 1;
+    config.sample_per_pixel = 2;
+    config.adaptive_sampling = true;
+    config.adaptive_threshold = 0.5f;
+    config.max_spp = 256;
+
+    config.num_threads = 1;
+    krt::PixelBuffer reference = krt::renderSceneToBuffer(scene, config);
+
+    config.num_threads = 4;
+    krt::RenderHandle handle = krt::renderSceneAsync(scene, config);
+
+    int polls = 0;
+    while (!handle.isDone())
+    {
+        float progress = handle.progress();
+        if (!(progress >= 0.0f && progress <= 1.0f))
+        {
+            std::cerr << "progress " << progress << " out of range" << std::endl;
+            handle.cancel();
+            handle.wait();
+            return 1;
+        }
+        polls++;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    if (handle.progress() != 1.0f)
+    {
+        std::cerr << "finished render reports progress " << handle.progress() << std::endl;
+        return 1;
+    }
+
+    krt::RenderStats stats = handle.stats();
+    if (polls == 0 || stats.passes < 2 || stats.passes >= config.max_spp / config.sample_per_pixel)
+    {
+        std::cerr << "expected a few rounds ending before max_spp, got " << polls << " polls, "
+                  << stats.passes << " rounds" << std::endl;
+        return 1;
+    }
+
+    // some tiles converge before others, or the render was not adaptive
+    int fewest = config.max_spp;
+    int most = 0;
+    for (const krt::RegionSamples& region : stats.regionSamples)
+    {
+        fewest = std::min(fewest, region.maxSamples);
+        most = std::max(most, region.maxSamples);
+    }
+    if (fewest >= most)
+    {
+        std::cerr << "every tile got " << most << " samples" << std::endl;
+        return 1;
+    }
+
+    float diff = maxDifference(reference, handle.get());
+    if (diff != 0.0f)
+    {
+        std::cerr << "async render differs from the single threaded render by " << diff << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef BUFFERCOMPARE_H
+#define BUFFERCOMPARE_H
+
+#include <kanima/util/pixelBuffer.h>
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+// Largest difference of a colour channel between two renders, infinity if the sizes
+// differ or a channel is not a number. 0 means the images are identical.
+inline float maxDifference(const krt::PixelBuffer& a, const krt::PixelBuffer& b)
+{
+    if (a.getWidth() != b.getWidth() || a.getHeight() != b.getHeight())
+        return std::numeric_limits<float>::infinity();
+
+    float maxDiff = 0.0f;
+    for (int y = 0; y < a.getHeight(); ++y)
+    {
+        for (int x = 0; x < a.getWidth(); ++x)
+        {
+            const krt::Color ca = a.getColor(x, y);
+            const krt::Color cb = b.getColor(x, y);
+            const float diffs[3] = {std::abs(ca.r - cb.r), std::abs(ca.g - cb.g), std::abs(ca.b - cb.b)};
+            for (float diff : diffs)
+            {
+                if (std::isnan(diff))
+                    return std::numeric_limits<float>::infinity();
+                maxDiff = std::max(maxDiff, diff);
+            }
+        }
+    }
+    return maxDiff;
+}
+
+// mean of all channels, to tell a dark image from a matching one
+inline double meanValue(const krt::PixelBuffer& buffer)
+{
+    double sum = 0.0;
+    for (int y = 0; y < buffer.getHeight(); ++y)
+    {
+        for (int x = 0; x < buffer.getWidth(); ++x)
+        {
+            const krt::Color c = buffer.getColor(x, y);
+            sum += c.r + c.g + c.b;
+        }
+    }
+    return sum / (3.0 * buffer.getWidth() * buffer.getHeight());
+}
+
+#endif // BUFFERCOMPARE_H
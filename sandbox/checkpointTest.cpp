@@ -0,0 +1,91 @@
+#include <kanima/core/scene.h>
+#include <kanima/util/renderScene.h>
+#include <kanima/util/pixelBuffer.h>
+
+#include "bufferCompare.h"
+
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+// A render resumed from a checkpoint must match an uninterrupted one bit for bit,
+// and a checkpoint of another scene must not be continued.
+int main()
+{
+    const std::string checkpointFile = "checkpointTest.ckpt";
+    std::remove(checkpointFile.c_str());
+
+    krt::Scene scene("dragon.crtscene");
+
+    krt::RenderConfig config;
+    config.buffer_width = 96;
+    config.buffer_height = 54;
+    config.bucket_size = 16;
+    config.num_threads = 2;
+    config.ray_depth = 3;
+    config.gi_ray_count = 1;
+    config.progressive = true;
+    config.sample_per_pixel = 4;
+
+    krt::PixelBuffer uninterrupted = krt::renderSceneToBuffer(scene, config);
+
+    // stops after 2 of the 4 passes
+    config.checkpoint_file = checkpointFile;
+    config.sample_per_pixel = 2;
+    krt::renderSceneToBuffer(scene, config);
+
+    config.sample_per_pixel = 4;
+    config.resume_checkpoint = true;
+    config.bucket_size = 24; // the tiling may change on resume
+    krt::RenderHandle resumedRender = krt::renderSceneAsync(scene, config);
+    krt::PixelBuffer resumed = resumedRender.get();
+
+    if (resumedRender.isCancelled() || resumedRender.stats().resumedPasses != 2)
+    {
+        std::cerr << "checkpoint was not resumed" << std::endl;
+        return 1;
+    }
+
+    float diff = maxDifference(uninterrupted, resumed);
+    if (diff != 0.0f)
+    {
+        std::cerr << "resumed render differs from the uninterrupted one by " << diff << std::endl;
+        return 1;
+    }
+
+    krt::Scene otherScene("glassball.crtscene");
+    krt::RenderHandle otherRender = krt::renderSceneAsync(otherScene, config);
+    otherRender.wait();
+    if (!otherRender.isCancelled())
+    {
+        std::cerr << "checkpoint of another scene was continued" << std::endl;
+        return 1;
+    }
+
+    // a header asking for a huge buffer is rejected before anything is allocated
+    {
+        std::ofstream out(checkpointFile, std::ios::binary | std::ios::trunc);
+        const char magic[8] = {'K', 'R', 'T', 'C', 'K', 'P', 'T', '\0'};
+        const uint32_t version = 1, seed = 0;
+        const int32_t width = 1000000, height = 1000000, passes = 1;
+        const uint64_t configHash = 0;
+        out.write(magic, sizeof(magic));
+        out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        out.write(reinterpret_cast<const char*>(&width), sizeof(width));
+        out.write(reinterpret_cast<const char*>(&height), sizeof(height));
+        out.write(reinterpret_cast<const char*>(&configHash), sizeof(configHash));
+        out.write(reinterpret_cast<const char*>(&seed), sizeof(seed));
+        out.write(reinterpret_cast<const char*>(&passes), sizeof(passes));
+    }
+    krt::RenderHandle foreignRender = krt::renderSceneAsync(scene, config);
+    foreignRender.wait();
+    if (!foreignRender.isCancelled())
+    {
+        std::cerr << "checkpoint of another image size was continued" << std::endl;
+        return 1;
+    }
+
+    std::remove(checkpointFile.c_str());
+    return 0;
+}
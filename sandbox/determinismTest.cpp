@@ -0,0 +1,47 @@
+#include <kanima/core/scene.h>
+#include <kanima/util/renderScene.h>
+#include <kanima/util/pixelBuffer.h>
+
+#include "bufferCompare.h"
+
+#include <iostream>
+
+// The samples depend only on the seed, the pixel and the sample number, so the image
+// must be bit-identical for any thread count and tiling.
+int main()
+{
+    krt::Scene scene("dragon.crtscene");
+
+    krt::RenderConfig config;
+    config.buffer_width = 128;
+    config.buffer_height = 72;
+    config.ray_depth = 3;
+    config.gi_ray_count = 2;
+    config.sample_per_pixel = 2;
+
+    config.num_threads = 1;
+    config.bucket_size = 16;
+    krt::PixelBuffer reference = krt::renderSceneToBuffer(scene, config);
+
+    const int threadCounts[] = {1, 4};
+    const int bucketSizes[] = {16, 40};
+    for (int threads : threadCounts)
+    {
+        for (int bucketSize : bucketSizes)
+        {
+            config.num_threads = threads;
+            config.bucket_size = bucketSize;
+            krt::PixelBuffer buffer = krt::renderSceneToBuffer(scene, config);
+
+            float diff = maxDifference(reference, buffer);
+            if (diff != 0.0f)
+            {
+                std::cerr << threads << " threads, bucket size " << bucketSize
+                          << ": image differs by " << diff << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
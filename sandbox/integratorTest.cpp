@@ -0,0 +1,63 @@
+#include <kanima/core/scene.h>
+#include <kanima/util/renderScene.h>
+#include <kanima/util/pixelBuffer.h>
+
+#include "bufferCompare.h"
+
+#include <iostream>
+
+// The integrators follow the same rays with the same random numbers, only the sums are
+// formed in another order.
+const float TOLERANCE = 1e-3f;
+
+bool matches(const krt::PixelBuffer& expected, const krt::PixelBuffer& actual, const std::string& what)
+{
+    float diff = maxDifference(expected, actual);
+    std::cout << what << " differs by " << diff << ", mean " << meanValue(expected) << std::endl;
+    if (!(diff <= TOLERANCE))
+    {
+        std::cerr << what << ": difference above " << TOLERANCE << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool compareIntegrators(const std::string& sceneFileName)
+{
+    krt::Scene scene(sceneFileName);
+
+    krt::RenderConfig config;
+    config.buffer_width = 96;
+    config.buffer_height = 54;
+    config.num_threads = 2;
+    config.ray_depth = 5;
+    config.gi_ray_count = 2;
+    config.sample_per_pixel = 2;
+    config.rr_start_depth = 2;
+
+    config.integrator = krt::Integrator::Recursive;
+    krt::PixelBuffer recursive = krt::renderSceneToBuffer(scene, config);
+
+    config.integrator = krt::Integrator::Iterative;
+    krt::PixelBuffer iterative = krt::renderSceneToBuffer(scene, config);
+
+    config.integrator = krt::Integrator::Wavefront;
+    krt::PixelBuffer wavefront = krt::renderSceneToBuffer(scene, config);
+
+    // batches of about 4000 samples, their GI rays are shaded in several chunks
+    config.bucket_size = 96;
+    krt::PixelBuffer wavefrontChunked = krt::renderSceneToBuffer(scene, config);
+
+    return matches(recursive, iterative, sceneFileName + ": iterative against recursive")
+        && matches(iterative, wavefront, sceneFileName + ": wavefront against iterative")
+        && matches(iterative, wavefrontChunked, sceneFileName + ": chunked wavefront against iterative");
+}
+
+int main()
+{
+    // diffuse GI with roulette, and refraction with GI behind the glass
+    if (!compareIntegrators("dragon.crtscene") || !compareIntegrators("glassball.crtscene"))
+        return 1;
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include <kanima/core/scene.h>
+#include <kanima/core/meshLoader.h>
+#include <kanima/util/renderScene.h>
+#include <kanima/util/pixelBuffer.h>
+
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+
+// unit cube written as quads in each format
+const float cubeVertices[8][3] = {
+    {-1, -1, -1}, {1, -1, -1}, {1, 1, -1}, {-1, 1, -1},
+    {-1, -1, 1}, {1, -1, 1}, {1, 1, 1}, {-1, 1, 1}
+};
+
+const int cubeQuads[6][4] = {
+    {0, 3, 2, 1}, {4, 5, 6, 7}, {0, 1, 5, 4},
+    {2, 3, 7, 6}, {1, 2, 6, 5}, {0, 4, 7, 3}
+};
+
+void writeOBJ(const std::string& fileName)
+{
+    std::ofstream out(fileName);
+    out << "# cube\no cube\n";
+    for (auto& v : cubeVertices)
+        out << "v " << v[0] << " " << v[1] << " " << v[2] << "\n";
+    for (int i = 0; i < 6; ++i)
+    {
+        out << "f";
+        for (int k = 0; k < 4; ++k)
+        {
+            // mix absolute and relative indices with vt/vn references
+            if (i % 2 == 0)
+                out << " " << cubeQuads[i][k] + 1 << "/1/1";
+            else
+                out << " " << cubeQuads[i][k] - 8;
+        }
+        out << "\n";
+    }
+}
+
+void writeAsciiPLY(const std::string& fileName)
+{
+    std::ofstream out(fileName);
+    out << "ply\nformat ascii 1.0\ncomment cube\n"
+        << "element vertex 8\nproperty float x\nproperty float y\nproperty float z\n"
+        << "element face 6\nproperty list uchar int vertex_indices\nend_header\n";
+    for (auto& v : cubeVertices)
+        out << v[0] << " " << v[1] << " " << v[2] << "\n";
+    for (auto& q : cubeQuads)
+        out << "4 " << q[0] << " " << q[1] << " " << q[2] << " " << q[3] << "\n";
+}
+
+void writeBinaryPLY(const std::string& fileName)
+{
+    std::ofstream out(fileName, std::ios::binary);
+    out << "ply\nformat binary_little_endian 1.0\n"
+        << "element vertex 8\nproperty float x\nproperty float y\nproperty float z\n"
+        << "element face 6\nproperty list uchar int vertex_indices\nend_header\n";
+    out.write(reinterpret_cast<const char*>(cubeVertices), sizeof(cubeVertices));
+    for (auto& q : cubeQuads)
+    {
+        unsigned char n = 4;
+        out.write(reinterpret_cast<const char*>(&n), 1);
+        out.write(reinterpret_cast<const char*>(q), 4 * sizeof(int32_t));
+    }
+}
+
+// header claims far more entries than the file holds
+void writeTruncatedPLY(const std::string& fileName)
+{
+    std::ofstream out(fileName, std::ios::binary);
+    out << "ply\nformat binary_little_endian 1.0\n"
+        << "element vertex 4000000000\nproperty float x\nproperty float y\nproperty float z\n"
+        << "element face 4000000000\nproperty list uchar int vertex_indices\nend_header\n";
+    out.write(reinterpret_cast<const char*>(cubeVertices), sizeof(cubeVertices));
+}
+
+// a face whose vertex count is negative
+void writeNegativeListPLY(const std::string& fileName)
+{
+    std::ofstream out(fileName, std::ios::binary);
+    out << "ply\nformat binary_little_endian 1.0\n"
+        << "element vertex 8\nproperty float x\nproperty float y\nproperty float z\n"
+        << "element face 1\nproperty list int int vertex_indices\nend_header\n";
+    out.write(reinterpret_cast<const char*>(cubeVertices), sizeof(cubeVertices));
+    const int32_t face[4] = {-1, 0, 1, 2};
+    out.write(reinterpret_cast<const char*>(face), sizeof(face));
+}
+
+bool checkCube(const std::string& fileName)
+{
+    krt::Mesh mesh;
+    if (!krt::loadMeshFromFile(fileName, mesh, 4))
+        return false;
+
+    bool ok = mesh.vertices.size() == 8 && mesh.triangleVertIndices.size() == 36
+            && mesh.triangleNormals.size() == 12 && mesh.vertexNormals.size() == 8;
+    if (!ok)
+        std::cerr << fileName << ": wrong vertex/triangle count" << std::endl;
+    return ok;
+}
+
+int main()
+{
+    writeOBJ("cube.obj");
+    writeAsciiPLY("cube_ascii.ply");
+    writeBinaryPLY("cube_binary.ply");
+
+    if (!checkCube("cube.obj") || !checkCube("cube_ascii.ply") || !checkCube("cube_binary.ply"))
+        return 1;
+
+    writeTruncatedPLY("truncated.ply");
+    krt::Mesh truncated;
+    if (krt::loadPLY("truncated.ply", truncated, 4))
+    {
+        std::cerr << "truncated.ply: loaded a file shorter than its header" << std::endl;
+        return 1;
+    }
+
+    writeNegativeListPLY("negative_list.ply");
+    krt::Mesh negativeList;
+    if (krt::loadPLY("negative_list.ply", negativeList, 4))
+    {
+        std::cerr << "negative_list.ply: loaded a negative list length" << std::endl;
+        return 1;
+    }
+
+    krt::Scene scene;
+    krt::Mesh cube;
+    krt::loadMeshFromFile("cube_binary.ply", cube);
+
+    std::string name = "cubeAlbedo";
+    auto albedo = std::make_shared<krt::AlbedoTexture>(name, krt::Color(0.9f, 0.4f, 0.2f));
+    scene.addTexture(name, albedo);
+
+    krt::Material material(albedo, krt::MaterialType::Diffuse, false);
+    cube.setMaterial(material);
+    scene.addMaterial(material);
+    scene.addMesh(cube);
+
+    krt::vec3 lightPos(3, 4, 5);
+    krt::Light light(lightPos, 800);
+    scene.addLight(light);
+
+    scene.camera.dolly(-5);
+    scene.camera.boom(1);
+
+    krt::RenderConfig config;
+    config.buffer_width = 160;
+    config.buffer_height = 90;
+    config.num_threads = 4;
+
+    krt::PixelBuffer buffer = krt::renderSceneToBuffer(scene, config);
+    buffer.writeToPPM("cube.ppm");
+
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <kanima/core/scene.h>
+#include <kanima/util/renderScene.h>
+#include <kanima/util/multiProcessRender.h>
+#include <kanima/util/pixelBuffer.h>
+
+#include "bufferCompare.h"
+
+#include <sys/types.h>
+#include <signal.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// processes started by this one, read from /proc
+std::vector<pid_t> childProcesses()
+{
+    std::vector<pid_t> children;
+    DIR* proc = opendir("/proc");
+    if (!proc)
+        return children;
+
+    while (dirent* entry = readdir(proc))
+    {
+        pid_t pid = static_cast<pid_t>(std::atoi(entry->d_name));
+        if (pid <= 0)
+            continue;
+
+        // pid (comm) state ppid ..., comm may contain spaces
+        std::ifstream statFile("/proc/" + std::string(entry->d_name) + "/stat");
+        std::string stat;
+        std::getline(statFile, stat);
+        size_t commEnd = stat.rfind(')');
+        if (commEnd == std::string::npos)
+            continue;
+
+        std::istringstream fields(stat.substr(commEnd + 1));
+        std::string state;
+        pid_t parent = 0;
+        fields >> state >> parent;
+        if (parent == getpid() && state != "Z")
+            children.push_back(pid);
+    }
+    closedir(proc);
+    return children;
+}
+
+// Renders while another thread sends signal to the first victims workers once the workers
+// are running. Returns false if the render finished before they could be signalled.
+bool renderWithSignal(krt::Scene& scene, krt::RenderConfig& config, int signal, size_t victims,
+                      krt::PixelBuffer& buffer, krt::RenderStats& stats, const char* what)
+{
+    std::atomic<bool> renderDone(false);
+    std::atomic<bool> signalled(false);
+
+    std::thread disturber([&]()
+    {
+        while (!renderDone.load())
+        {
+            std::vector<pid_t> children = childProcesses();
+            if (children.size() == 2)
+            {
+                // let the workers get into their first tiles
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                bool all = !renderDone.load();
+                for (size_t i = 0; all && i < victims; ++i)
+                    all = kill(children[i], signal) == 0;
+                signalled = all;
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+
+    buffer = krt::renderSceneMultiProcess(scene, config, 2, &stats);
+    renderDone = true;
+    disturber.join();
+
+    if (!signalled.load())
+    {
+        std::cerr << what << ": the render finished before the workers could be disturbed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// One disturbed worker: the other one renders its tiles, the image must match the reference.
+bool survivesSignal(krt::Scene& scene, krt::RenderConfig& config, const krt::PixelBuffer& reference, int signal, const char* what)
+{
+    krt::PixelBuffer buffer(0, 0);
+    krt::RenderStats stats;
+    if (!renderWithSignal(scene, config, signal, 1, buffer, stats, what))
+        return false;
+
+    float diff = maxDifference(reference, buffer);
+    if (diff != 0.0f || stats.bucketsLost != 0)
+    {
+        std::cerr << what << ": image differs from the single process render by " << diff
+                  << ", " << stats.bucketsLost << " buckets lost" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    krt::Scene scene("dragon.crtscene");
+
+    krt::RenderConfig config;
+    config.buffer_width = 192;
+    config.buffer_height = 108;
+    config.bucket_size = 12;
+    config.num_threads = 1;
+    config.ray_depth = 3;
+    config.gi_ray_count = 1;
+    config.sample_per_pixel = 2;
+
+    krt::PixelBuffer reference = krt::renderSceneToBuffer(scene, config);
+
+    krt::RenderStats stats;
+    krt::PixelBuffer buffer = krt::renderSceneMultiProcess(scene, config, 2, &stats);
+    float diff = maxDifference(reference, buffer);
+    if (diff != 0.0f || stats.bucketsLost != 0)
+    {
+        std::cerr << "two process render differs from the single process render by " << diff
+                  << ", " << stats.bucketsLost << " buckets lost" << std::endl;
+        return 1;
+    }
+
+    // a crashed worker's tile is rendered by the other one
+    if (!survivesSignal(scene, config, reference, SIGKILL, "killed worker"))
+        return 1;
+
+    // a stopped worker never answers, the coordinator has to time it out
+    config.tile_timeout_seconds = 0.5;
+    if (!survivesSignal(scene, config, reference, SIGSTOP, "hung worker"))
+        return 1;
+
+    // with every worker timed out the render cannot finish, and must say so
+    if (!renderWithSignal(scene, config, SIGSTOP, 2, buffer, stats, "all workers hung"))
+        return 1;
+    if (stats.bucketsLost <= 0)
+    {
+        std::cerr << "all workers hung: no buckets reported lost" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <kanima/core/scene.h>
+#include <kanima/util/renderScene.h>
+#include <kanima/util/pixelBuffer.h>
+
+#include "bufferCompare.h"
+
+#include <iostream>
+#include <vector>
+
+// Scene::tracePacketBVH is a second BVH traversal, it must find exactly the hits of
+// traceRayBVH, for camera packets and for packets whose rays do not share an origin.
+
+bool sameHit(const krt::IntersectionData& a, const krt::IntersectionData& b)
+{
+    return a.objectIdx == b.objectIdx && a.triangleIdx == b.triangleIdx
+        && a.hitPoint.x == b.hitPoint.x && a.hitPoint.y == b.hitPoint.y && a.hitPoint.z == b.hitPoint.z;
+}
+
+bool comparePacketHits(krt::Scene& scene, int width, int height)
+{
+    std::vector<krt::Ray> rays;
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            rays.push_back(scene.camera.generateRay((x + 0.5f) / width, (y + 0.5f) / height));
+
+    int mismatches = 0;
+    krt::IntersectionData hits[krt::RAY_PACKET_SIZE];
+    for (int shifted = 0; shifted < 2; ++shifted)
+    {
+        for (size_t first = 0; first < rays.size(); first += krt::RAY_PACKET_SIZE)
+        {
+            const int count = static_cast<int>(std::min<size_t>(krt::RAY_PACKET_SIZE, rays.size() - first));
+            krt::Ray packet[krt::RAY_PACKET_SIZE];
+            for (int i = 0; i < count; ++i)
+            {
+                packet[i] = rays[first + i];
+                // a different origin per ray turns the frustum test off
+                if (shifted)
+                    packet[i].o = packet[i].o + packet[i].d * (0.05f * i);
+            }
+
+            scene.tracePacketBVH(packet, count, hits);
+            for (int i = 0; i < count; ++i)
+                if (!sameHit(hits[i], scene.traceRayBVH(packet[i])))
+                    mismatches++;
+        }
+    }
+
+    if (mismatches > 0)
+    {
+        std::cerr << mismatches << " packet hits differ from single ray hits" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool comparePacketRenders(const std::string& sceneFileName)
+{
+    krt::Scene scene(sceneFileName);
+
+    krt::RenderConfig config;
+    config.buffer_width = 96;
+    config.buffer_height = 54;
+    config.num_threads = 2;
+    config.ray_depth = 4;
+    config.gi_ray_count = 1;
+    config.sample_per_pixel = 2;
+
+    krt::prepareSceneForRender(krt::RenderContext::defaultContext(), scene, config);
+    if (!comparePacketHits(scene, 320, 180))
+    {
+        std::cerr << sceneFileName << ": packet traversal out of step" << std::endl;
+        return false;
+    }
+
+    const krt::Integrator integrators[] = {krt::Integrator::Recursive, krt::Integrator::Iterative, krt::Integrator::Wavefront};
+    for (krt::Integrator integrator : integrators)
+    {
+        config.integrator = integrator;
+        config.primary_ray_packets = true;
+        krt::PixelBuffer packets = krt::renderSceneToBuffer(scene, config);
+        config.primary_ray_packets = false;
+        krt::PixelBuffer single = krt::renderSceneToBuffer(scene, config);
+
+        float diff = maxDifference(single, packets);
+        if (diff != 0.0f)
+        {
+            std::cerr << sceneFileName << ": integrator " << static_cast<int>(integrator)
+                      << " renders differently with camera ray packets, by " << diff << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    if (!comparePacketRenders("dragon.crtscene") || !comparePacketRenders("glassball.crtscene"))
+        return 1;
+
+    return 0;
+}
@@ -0,0 +1,273 @@
+#include <kanima/accTree/geometryPager.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+
+using namespace krt;
+
+void collectLeaves(BVHNode* root, std::vector<BVHNode*>& leaves)
+{
+    std::vector<BVHNode*> stack;
+    if (root)
+        stack.push_back(root);
+
+    while (!stack.empty())
+    {
+        BVHNode* node = stack.back();
+        stack.pop_back();
+
+        if (node->left == nullptr && node->right == nullptr)
+        {
+            leaves.push_back(node);
+            continue;
+        }
+
+        // right pushed first so leaves come out left to right
+        if (node->right)
+            stack.push_back(node->right.get());
+        if (node->left)
+            stack.push_back(node->left.get());
+    }
+}
+
+PagedTriangle makePagedTriangle(const Mesh& mesh, int meshIdx, int triangleIdx)
+{
+    const int i0 = mesh.triangleVertIndices[triangleIdx * 3];
+    const int i1 = mesh.triangleVertIndices[triangleIdx * 3 + 1];
+    const int i2 = mesh.triangleVertIndices[triangleIdx * 3 + 2];
+
+    PagedTriangle tri;
+    tri.v0 = mesh.vertices[i0];
+    tri.v1 = mesh.vertices[i1];
+    tri.v2 = mesh.vertices[i2];
+    tri.normal = mesh.triangleNormals[triangleIdx];
+    tri.n0 = mesh.vertexNormals[i0];
+    tri.n1 = mesh.vertexNormals[i1];
+    tri.n2 = mesh.vertexNormals[i2];
+
+    // in older programs vertexUVs are empty
+    if (!mesh.vertexUVs.empty())
+    {
+        tri.uv0 = mesh.vertexUVs[i0];
+        tri.uv1 = mesh.vertexUVs[i1];
+        tri.uv2 = mesh.vertexUVs[i2];
+    }
+
+    tri.meshIdx = meshIdx;
+    tri.triangleIdx = triangleIdx;
+    return tri;
+}
+
+template <typename T>
+void release(std::vector<T>& v)
+{
+    std::vector<T>().swap(v);
+}
+
+}
+
+namespace krt
+{
+
+BaryCoord PagedTriangle::findBaryCentricCoords(const vec3& point) const
+{
+    vec3 e01 = v1 - v0;
+    vec3 e02 = v2 - v0;
+
+    vec3 e0p = point - v0;
+
+    float area_tri = e01.cross(e02).length() / 2.0f;
+    float area_m = e0p.cross(e02).length() / 2.0f;
+    float area_n = e01.cross(e0p).length() / 2.0f;
+
+    float u = area_m / area_tri;
+    float v = area_n / area_tri;
+    float w = 1 - u - v;
+
+    return BaryCoord(u, v, w);
+}
+
+vec3 PagedTriangle::findInterpolatedVertNormal(const BaryCoord& bary) const
+{
+    return n0*bary.w + n1*bary.u + n2*bary.v;
+}
+
+void PagedTriangle::findTextureUV(const BaryCoord& bary, float& u, float& v) const
+{
+    // only u and v needed for texture coordinate
+    u = bary.u * uv1.x + bary.v * uv2.x + bary.w * uv0.x;
+    v = bary.u * uv1.y + bary.v * uv2.y + bary.w * uv0.y;
+}
+
+
+GeometryPager::GeometryPager() : maxResidentPages(1), pageFaults(0), cacheHits(0) {}
+
+bool GeometryPager::create(const std::string& fileName, std::vector<Mesh>& meshes, BVHNode* root,
+                           size_t maxResidentBytes, int trianglesPerPage)
+{
+    trianglesPerPage = std::max(1, trianglesPerPage);
+
+    std::vector<BVHNode*> leaves;
+    collectLeaves(root, leaves);
+
+    std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+
+    pageOffsets.clear();
+    pageSizes.clear();
+
+    // whole leaves are packed into pages in tree order, so nearby leaves share pages
+    size_t offset = 0;
+    std::vector<PagedTriangle> leafTriangles;
+    bool written = true;
+    for (BVHNode* leaf : leaves)
+    {
+        const int count = static_cast<int>(leaf->triangleIndices.size());
+
+        if (pageSizes.empty() || (pageSizes.back() > 0 && pageSizes.back() + count > trianglesPerPage))
+        {
+            pageOffsets.push_back(offset);
+            pageSizes.push_back(0);
+        }
+
+        leaf->pageIdx = static_cast<int>(pageSizes.size()) - 1;
+        leaf->pageFirst = pageSizes.back();
+        leaf->pageCount = count;
+
+        leafTriangles.clear();
+        for (const auto& trianglePair : leaf->triangleIndices)
+            leafTriangles.push_back(makePagedTriangle(meshes[trianglePair.first], trianglePair.first, trianglePair.second));
+
+        out.write(reinterpret_cast<const char*>(leafTriangles.data()), count * sizeof(PagedTriangle));
+        if (!out)
+        {
+            written = false;
+            break;
+        }
+        pageSizes.back() += count;
+        offset += count * sizeof(PagedTriangle);
+    }
+
+    out.close();
+    if (!written || !out || offset == 0 || !file.open(fileName))
+    {
+        // the leaves and meshes are untouched, traversal stays on the resident geometry
+        for (BVHNode* leaf : leaves)
+            leaf->pageIdx = -1;
+        pageOffsets.clear();
+        pageSizes.clear();
+        unlink(fileName.c_str());
+        return false;
+    }
+
+    // the mapping keeps the data, the name is not needed anymore
+    unlink(fileName.c_str());
+    madvise(const_cast<char*>(file.begin()), file.size(), MADV_RANDOM);
+
+    for (BVHNode* leaf : leaves)
+        release(leaf->triangleIndices);
+
+    for (Mesh& mesh : meshes)
+    {
+        release(mesh.vertices);
+        release(mesh.triangleVertIndices);
+        release(mesh.triangleNormals);
+        release(mesh.vertexNormals);
+        release(mesh.vertexUVs);
+    }
+
+    const size_t pageBytes = static_cast<size_t>(trianglesPerPage) * sizeof(PagedTriangle);
+    maxResidentPages = std::max<size_t>(1, maxResidentBytes / pageBytes);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    lru.clear();
+    resident.clear();
+    return true;
+}
+
+std::shared_ptr<const GeometryPage> GeometryPager::readPage(int pageIdx)
+{
+    const char* src = file.begin() + pageOffsets[pageIdx];
+    const size_t bytes = pageSizes[pageIdx] * sizeof(PagedTriangle);
+
+    std::shared_ptr<GeometryPage> page = std::make_shared<GeometryPage>();
+    page->triangles.resize(pageSizes[pageIdx]);
+    std::memcpy(&page->triangles[0], src, bytes);
+
+    // drop the file's pages again, only the cached copy stays resident
+    const uintptr_t osPageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t start = reinterpret_cast<uintptr_t>(src) & ~(osPageSize - 1);
+    madvise(reinterpret_cast<void*>(start), bytes + (reinterpret_cast<uintptr_t>(src) - start), MADV_DONTNEED);
+
+    return page;
+}
+
+std::shared_ptr<const GeometryPage> GeometryPager::acquire(int pageIdx)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = resident.find(pageIdx);
+        if (it != resident.end())
+        {
+            lru.splice(lru.begin(), lru, it->second.lruPos);
+            cacheHits++;
+            return it->second.page;
+        }
+    }
+
+    // read outside the lock so other threads keep hitting the cache
+    pageFaults++;
+    std::shared_ptr<const GeometryPage> page = readPage(pageIdx);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = resident.find(pageIdx);
+    if (it != resident.end())
+    {
+        // another thread faulted the same page in meanwhile
+        lru.splice(lru.begin(), lru, it->second.lruPos);
+        return it->second.page;
+    }
+
+    lru.push_front(pageIdx);
+    Entry entry;
+    entry.page = page;
+    entry.lruPos = lru.begin();
+    resident[pageIdx] = entry;
+
+    while (resident.size() > maxResidentPages)
+    {
+        resident.erase(lru.back());
+        lru.pop_back();
+    }
+
+    return page;
+}
+
+GeometryPagerStats GeometryPager::stats()
+{
+    GeometryPagerStats s;
+    s.pageFaults = pageFaults.load();
+    s.cacheHits = cacheHits.load();
+    s.maxResidentPages = maxResidentPages;
+    s.pageCount = pageSizes.size();
+
+    std::lock_guard<std::mutex> lock(mtx);
+    s.residentPages = resident.size();
+    return s;
+}
+
+void GeometryPager::resetStats()
+{
+    pageFaults = 0;
+    cacheHits = 0;
+}
+
+}
@@ -17,6 +17,11 @@ Color Color::operator*(float scalar) const
     return Color(r * scalar, g * scalar, b * scalar);
 }
 
+Color Color::operator*(const Color& other) const
+{
+    return Color(r * other.r, g * other.g, b * other.b);
+}
+
 Color operator*(float scalar, const Color& c)
 {
     return c * scalar;
@@ -1,8 +1,36 @@
 #include <kanima/core/mesh.h>
+#include <kanima/util/parallelFor.h>
+#include <kanima/sampler/pcg32.h>
 #include <cstdlib>
 #include <vector>
 #include <cassert>
 #include <limits>
+#include <algorithm>
+
+namespace
+{
+// meshes smaller than this are not worth the thread start-up
+const size_t PARALLEL_MIN_ELEMENTS = 1 << 16;
+const size_t PARALLEL_BLOCK_SIZE = 1 << 14;
+
+// calls body(first, last) over [0, count) in blocks
+template <typename Body>
+void forEachBlock(size_t count, int numThreads, Body body)
+{
+    if (numThreads <= 1 || count < PARALLEL_MIN_ELEMENTS)
+    {
+        body(size_t(0), count);
+        return;
+    }
+
+    int blocks = static_cast<int>((count + PARALLEL_BLOCK_SIZE - 1) / PARALLEL_BLOCK_SIZE);
+    krt::parallelFor(0, blocks, numThreads, [&](int b)
+    {
+        size_t first = static_cast<size_t>(b) * PARALLEL_BLOCK_SIZE;
+        body(first, std::min(count, first + PARALLEL_BLOCK_SIZE));
+    });
+}
+}
 
 namespace krt
 {
@@ -63,9 +91,11 @@ std::vector<Triangle> Mesh::generateTriangleList() const
 
         if (this->randomizeColors)
         {
-            float r = static_cast<float>(std::rand()) / static_cast<float>(RAND_MAX);//rand() % 256;
-            float g = static_cast<float>(std::rand()) / static_cast<float>(RAND_MAX);//rand() % 256;
-            float b = static_cast<float>(std::rand()) / static_cast<float>(RAND_MAX);//rand() % 256;
+            // the same colors on every run
+            Pcg32 rng(i);
+            float r = rng.nextFloat();
+            float g = rng.nextFloat();
+            float b = rng.nextFloat();
 
             color = Color(r, g, b);
         }
@@ -105,50 +135,91 @@ void Mesh::setMaterial(const Material& material)
     this->material = material;
 }
 
-void Mesh::computeTriangleNormals()
+void Mesh::computeTriangleNormals(int numThreads)
 {
-    triangleNormals.clear();
-    triangleNormals.reserve(triangleVertIndices.size()/3);
+    const size_t triangleCount = triangleVertIndices.size() / 3;
+    triangleNormals.resize(triangleCount);
 
-    for (size_t i = 0; i < triangleVertIndices.size(); i += 3)
+    const vec3* verts = vertices.data();
+    const int* indices = triangleVertIndices.data();
+    vec3* normals = triangleNormals.data();
+
+    // written out on floats so the loop has no calls; same operations as (e1.cross(e2)).normalized()
+    forEachBlock(triangleCount, numThreads, [=](size_t first, size_t last)
     {
-        vec3 v0 = vertices[triangleVertIndices[i]];
-        vec3 v1 = vertices[triangleVertIndices[i + 1]];
-        vec3 v2 = vertices[triangleVertIndices[i + 2]];
+        for (size_t t = first; t < last; ++t)
+        {
+            const vec3& v0 = verts[indices[t * 3]];
+            const vec3& v1 = verts[indices[t * 3 + 1]];
+            const vec3& v2 = verts[indices[t * 3 + 2]];
 
-        vec3 edge1 = v1 - v0;
-        vec3 edge2 = v2 - v0;
+            float e1x = v1.x - v0.x, e1y = v1.y - v0.y, e1z = v1.z - v0.z;
+            float e2x = v2.x - v0.x, e2y = v2.y - v0.y, e2z = v2.z - v0.z;
 
-        vec3 normal = (edge1.cross(edge2)).normalized();
-        triangleNormals.push_back(normal);
-    }
+            float nx = e1y * e2z - e1z * e2y;
+            float ny = e1z * e2x - e1x * e2z;
+            float nz = e1x * e2y - e1y * e2x;
+
+            float len = std::sqrt(nx * nx + ny * ny + nz * nz);
+            normals[t] = vec3(nx / len, ny / len, nz / len);
+        }
+    });
 }
 
-void Mesh::computeVertexNormals()
+void Mesh::computeVertexNormals(int numThreads)
 {
     // init vector's normals to 0,0,0
     vertexNormals = std::vector<vec3>(vertices.size(), vec3(0, 0, 0));
 
-    // for each vertex v of the triangle
-    //  add the triangle t's normal to v
-    for (size_t i = 0; i < triangleVertIndices.size(); i += 3)
+    if (numThreads <= 1 || vertices.size() < PARALLEL_MIN_ELEMENTS)
     {
-        const int i0 = triangleVertIndices[i];
-        const int i1 = triangleVertIndices[i + 1];
-        const int i2 = triangleVertIndices[i + 2];
+        // for each vertex v of the triangle
+        //  add the triangle t's normal to v
+        for (size_t i = 0; i < triangleVertIndices.size(); i += 3)
+        {
+            const int i0 = triangleVertIndices[i];
+            const int i1 = triangleVertIndices[i + 1];
+            const int i2 = triangleVertIndices[i + 2];
+
+            const vec3& triangleNormal = triangleNormals[i / 3];
 
-        const vec3& triangleNormal = triangleNormals[i / 3];
+            vertexNormals[i0] = vertexNormals[i0] + triangleNormal;
+            vertexNormals[i1] = vertexNormals[i1] + triangleNormal;
+            vertexNormals[i2] = vertexNormals[i2] + triangleNormal;
+        }
 
-        vertexNormals[i0] = vertexNormals[i0] + triangleNormal;
-        vertexNormals[i1] = vertexNormals[i1] + triangleNormal;
-        vertexNormals[i2] = vertexNormals[i2] + triangleNormal;
+        // normalize all vector normals
+        for (vec3& norm : vertexNormals)
+        {
+            norm = norm.normalized();
+        }
+        return;
     }
 
-    // normalize all vector normals
-    for (vec3& norm : vertexNormals)
+    // Scattering from many threads would race on shared vertices, so each vertex gathers
+    // its triangles instead. The vertex -> triangle table is filled in triangle order,
+    // which keeps the sums identical to the serial scatter above.
+    std::vector<int> firstTriangle(vertices.size() + 1, 0);
+    for (int idx : triangleVertIndices)
+        firstTriangle[idx + 1]++;
+    for (size_t v = 0; v < vertices.size(); ++v)
+        firstTriangle[v + 1] += firstTriangle[v];
+
+    std::vector<int> vertexTriangles(triangleVertIndices.size());
+    std::vector<int> cursor(firstTriangle.begin(), firstTriangle.end() - 1);
+    for (size_t i = 0; i < triangleVertIndices.size(); ++i)
+        vertexTriangles[cursor[triangleVertIndices[i]]++] = static_cast<int>(i / 3);
+
+    forEachBlock(vertices.size(), numThreads, [&](size_t first, size_t last)
     {
-        norm = norm.normalized();
-    }
+        for (size_t v = first; v < last; ++v)
+        {
+            vec3 sum(0, 0, 0);
+            for (int k = firstTriangle[v]; k < firstTriangle[v + 1]; ++k)
+                sum = sum + triangleNormals[vertexTriangles[k]];
+            vertexNormals[v] = sum.normalized();
+        }
+    });
 }
 
 double Mesh::intersectRay(const Ray& r, int& hitTriangleIndex, vec3& hitPoint, vec3& hitNormal, bool cullBackFaces) const
@@ -270,25 +341,53 @@ Color Mesh::getAlbedo(BaryCoord& baryPoint, int triangleIndex)
 }
 
 
-void Mesh::computeAABB()
+void Mesh::computeAABB(int numThreads)
 {
-    float minx, miny, minz, maxx, maxy, maxz;
-    minx = miny = minz = std::numeric_limits<float>::infinity();
-    maxx = maxy = maxz = -std::numeric_limits<float>::infinity();
+    struct Bounds
+    {
+        float minx, miny, minz, maxx, maxy, maxz;
+    };
 
-    for (vec3 vertex : this->vertices)
+    const float inf = std::numeric_limits<float>::infinity();
+    const Bounds empty = {inf, inf, inf, -inf, -inf, -inf};
+
+    const vec3* verts = vertices.data();
+    const size_t count = vertices.size();
+    const size_t blocks = std::max<size_t>(1, (count + PARALLEL_BLOCK_SIZE - 1) / PARALLEL_BLOCK_SIZE);
+    std::vector<Bounds> blockBounds(blocks, empty);
+
+    // per block min/max, reduced below
+    forEachBlock(count, numThreads, [&](size_t first, size_t last)
     {
-        minx = std::min(vertex.x, minx);
-        miny = std::min(vertex.y, miny);
-        minz = std::min(vertex.z, minz);
+        Bounds b = empty;
+
+        for (size_t i = first; i < last; ++i)
+        {
+            b.minx = std::min(verts[i].x, b.minx);
+            b.miny = std::min(verts[i].y, b.miny);
+            b.minz = std::min(verts[i].z, b.minz);
 
-        maxx = std::max(vertex.x, maxx);
-        maxy = std::max(vertex.y, maxy);
-        maxz = std::max(vertex.z, maxz);
+            b.maxx = std::max(verts[i].x, b.maxx);
+            b.maxy = std::max(verts[i].y, b.maxy);
+            b.maxz = std::max(verts[i].z, b.maxz);
+        }
+
+        blockBounds[first / PARALLEL_BLOCK_SIZE] = b;
+    });
+
+    Bounds total = empty;
+    for (const Bounds& b : blockBounds)
+    {
+        total.minx = std::min(b.minx, total.minx);
+        total.miny = std::min(b.miny, total.miny);
+        total.minz = std::min(b.minz, total.minz);
+        total.maxx = std::max(b.maxx, total.maxx);
+        total.maxy = std::max(b.maxy, total.maxy);
+        total.maxz = std::max(b.maxz, total.maxz);
     }
 
-    vec3 minv = vec3(minx, miny, minz);
-    vec3 maxv = vec3(maxx, maxy, maxz);
+    vec3 minv = vec3(total.minx, total.miny, total.minz);
+    vec3 maxv = vec3(total.maxx, total.maxy, total.maxz);
 
     this->boundingBox = AABB(minv, maxv);
 }
@@ -0,0 +1,988 @@
+#include <kanima/core/meshLoader.h>
+#include <kanima/util/mappedFile.h>
+#include <kanima/util/parallelFor.h>
+
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+// helper functions not exposed outside
+namespace
+{
+
+using namespace krt;
+
+// ----- Text parsing -----
+
+inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* skipBlanks(const char* p, const char* end)
+{
+    while (p < end && isBlank(*p))
+        ++p;
+    return p;
+}
+
+inline const char* skipToken(const char* p, const char* end)
+{
+    while (p < end && !isBlank(*p) && *p != '\n')
+        ++p;
+    return p;
+}
+
+inline const char* lineEnd(const char* p, const char* end)
+{
+    const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    return nl ? nl : end;
+}
+
+inline const char* nextLine(const char* p, const char* end)
+{
+    const char* le = lineEnd(p, end);
+    return le < end ? le + 1 : end;
+}
+
+// the mapping is not null terminated, so the token is copied before strtof
+bool parseFloat(const char*& p, const char* end, float& out)
+{
+    p = skipBlanks(p, end);
+    const char* tokenEnd = skipToken(p, end);
+    size_t len = tokenEnd - p;
+    if (len == 0 || len >= 64)
+        return false;
+
+    char buf[64];
+    std::memcpy(buf, p, len);
+    buf[len] = '\0';
+
+    char* parsedEnd = nullptr;
+    out = std::strtof(buf, &parsedEnd);
+    p = tokenEnd;
+    return parsedEnd != buf;
+}
+
+// stops at the first non digit, so "12/4/7" yields 12
+bool parseInt(const char*& p, const char* end, long& out)
+{
+    p = skipBlanks(p, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    const char* digitsStart = p;
+    long value = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        value = value * 10 + (*p - '0');
+        ++p;
+    }
+
+    out = negative ? -value : value;
+    return p != digitsStart;
+}
+
+// splits [begin, end) into about numChunks ranges that start and end on line boundaries
+std::vector<std::pair<const char*, const char*>> splitLines(const char* begin, const char* end, int numChunks)
+{
+    std::vector<std::pair<const char*, const char*>> chunks;
+    const size_t total = end - begin;
+    const char* start = begin;
+
+    for (int i = 1; i <= numChunks && start < end; ++i)
+    {
+        const char* stop = (i == numChunks) ? end : begin + total * i / numChunks;
+        if (stop < start)
+            continue;
+        if (stop < end)
+            stop = nextLine(stop, end);
+        if (stop > start)
+            chunks.push_back(std::make_pair(start, stop));
+        start = stop;
+    }
+
+    return chunks;
+}
+
+int chunkCountFor(size_t bytes, int numThreads)
+{
+    // ~1 MB chunks, a few per thread for load balance
+    const size_t chunkBytes = 1 << 20;
+    size_t n = std::max<size_t>(1, bytes / chunkBytes);
+    return static_cast<int>(std::min<size_t>(n, static_cast<size_t>(numThreads) * 4));
+}
+
+// drops triangles that repeat a vertex (Mesh::insertTriangleIndex asserts on them)
+void removeDegenerateTriangles(std::vector<int>& indices)
+{
+    size_t w = 0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        if (a == b || b == c || c == a)
+            continue;
+        indices[w++] = a;
+        indices[w++] = b;
+        indices[w++] = c;
+    }
+    indices.resize(w);
+}
+
+void finalizeMesh(Mesh& mesh)
+{
+    removeDegenerateTriangles(mesh.triangleVertIndices);
+    mesh.computeTriangleNormals();
+    mesh.computeVertexNormals();
+    mesh.computeAABB();
+}
+
+// ----- OBJ -----
+
+struct ObjIndex
+{
+    int value;
+    bool relative; // negative obj index, value is relative to the chunk's first vertex
+};
+
+struct ObjChunk
+{
+    std::vector<vec3> vertices;
+    std::vector<ObjIndex> indices;
+    bool ok = true;
+};
+
+void parseObjChunk(const char* p, const char* end, ObjChunk& chunk)
+{
+    std::vector<ObjIndex> face;
+
+    while (p < end)
+    {
+        const char* le = lineEnd(p, end);
+        p = skipBlanks(p, le);
+
+        if (le - p >= 2 && p[0] == 'v' && isBlank(p[1]))
+        {
+            p += 1;
+            float x, y, z;
+            if (!parseFloat(p, le, x) || !parseFloat(p, le, y) || !parseFloat(p, le, z))
+                chunk.ok = false;
+            else
+                chunk.vertices.push_back(vec3(x, y, z));
+        }
+        else if (le - p >= 2 && p[0] == 'f' && isBlank(p[1]))
+        {
+            p += 1;
+            face.clear();
+            while (true)
+            {
+                p = skipBlanks(p, le);
+                if (p >= le)
+                    break;
+
+                long idx;
+                if (!parseInt(p, le, idx) || idx == 0)
+                {
+                    chunk.ok = false;
+                    break;
+                }
+
+                ObjIndex oi;
+                if (idx > 0)
+                {
+                    oi.value = static_cast<int>(idx - 1);
+                    oi.relative = false;
+                }
+                else
+                {
+                    oi.value = static_cast<int>(chunk.vertices.size() + idx);
+                    oi.relative = true;
+                }
+                face.push_back(oi);
+
+                p = skipToken(p, le); // skip "/vt/vn"
+            }
+
+            // fan triangulation
+            for (size_t k = 1; k + 1 < face.size(); ++k)
+            {
+                chunk.indices.push_back(face[0]);
+                chunk.indices.push_back(face[k]);
+                chunk.indices.push_back(face[k + 1]);
+            }
+        }
+
+        p = (le < end) ? le + 1 : end;
+    }
+}
+
+// ----- PLY -----
+
+enum class PlyType
+{
+    Invalid,
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Float32,
+    Float64
+};
+
+enum class PlyFormat
+{
+    Ascii,
+    BinaryLittleEndian,
+    BinaryBigEndian
+};
+
+struct PlyProperty
+{
+    std::string name;
+    PlyType type = PlyType::Invalid;
+    bool isList = false;
+    PlyType countType = PlyType::Invalid;
+};
+
+struct PlyElement
+{
+    std::string name;
+    size_t count = 0;
+    std::vector<PlyProperty> properties;
+};
+
+PlyType plyTypeFromName(const std::string& name)
+{
+    if (name == "char" || name == "int8") return PlyType::Int8;
+    if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+    if (name == "short" || name == "int16") return PlyType::Int16;
+    if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+    if (name == "int" || name == "int32") return PlyType::Int32;
+    if (name == "uint" || name == "uint32") return PlyType::UInt32;
+    if (name == "float" || name == "float32") return PlyType::Float32;
+    if (name == "double" || name == "float64") return PlyType::Float64;
+    return PlyType::Invalid;
+}
+
+size_t plyTypeSize(PlyType type)
+{
+    switch (type)
+    {
+    case PlyType::Int8:
+    case PlyType::UInt8: return 1;
+    case PlyType::Int16:
+    case PlyType::UInt16: return 2;
+    case PlyType::Int32:
+    case PlyType::UInt32:
+    case PlyType::Float32: return 4;
+    case PlyType::Float64: return 8;
+    default: return 0;
+    }
+}
+
+bool hostIsLittleEndian()
+{
+    const uint16_t one = 1;
+    return *reinterpret_cast<const unsigned char*>(&one) == 1;
+}
+
+template <typename T>
+T readRaw(const char* p, bool swapBytes)
+{
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, p, sizeof(T));
+    if (swapBytes)
+        std::reverse(bytes, bytes + sizeof(T));
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+double readBinaryValue(const char* p, PlyType type, bool swapBytes)
+{
+    switch (type)
+    {
+    case PlyType::Int8: return readRaw<int8_t>(p, false);
+    case PlyType::UInt8: return readRaw<uint8_t>(p, false);
+    case PlyType::Int16: return readRaw<int16_t>(p, swapBytes);
+    case PlyType::UInt16: return readRaw<uint16_t>(p, swapBytes);
+    case PlyType::Int32: return readRaw<int32_t>(p, swapBytes);
+    case PlyType::UInt32: return readRaw<uint32_t>(p, swapBytes);
+    case PlyType::Float32: return readRaw<float>(p, swapBytes);
+    case PlyType::Float64: return readRaw<double>(p, swapBytes);
+    default: return 0.0;
+    }
+}
+
+bool parsePlyHeader(const MappedFile& file, PlyFormat& format, std::vector<PlyElement>& elements, const char*& bodyStart)
+{
+    const char* p = file.begin();
+    const char* end = file.end();
+
+    if (file.size() < 4 || std::strncmp(p, "ply", 3) != 0)
+        return false;
+
+    bool hasFormat = false;
+    while (p < end)
+    {
+        const char* le = lineEnd(p, end);
+        std::string line(p, le);
+        if (!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+        p = (le < end) ? le + 1 : end;
+
+        std::istringstream iss(line);
+        std::string keyword;
+        iss >> keyword;
+
+        if (keyword == "format")
+        {
+            std::string fmt;
+            iss >> fmt;
+            if (fmt == "ascii") format = PlyFormat::Ascii;
+            else if (fmt == "binary_little_endian") format = PlyFormat::BinaryLittleEndian;
+            else if (fmt == "binary_big_endian") format = PlyFormat::BinaryBigEndian;
+            else return false;
+            hasFormat = true;
+        }
+        else if (keyword == "element")
+        {
+            PlyElement element;
+            iss >> element.name >> element.count;
+            elements.push_back(element);
+        }
+        else if (keyword == "property")
+        {
+            if (elements.empty())
+                return false;
+
+            PlyProperty property;
+            std::string typeName;
+            iss >> typeName;
+            if (typeName == "list")
+            {
+                std::string countTypeName, itemTypeName;
+                iss >> countTypeName >> itemTypeName;
+                property.isList = true;
+                property.countType = plyTypeFromName(countTypeName);
+                property.type = plyTypeFromName(itemTypeName);
+                if (property.countType == PlyType::Invalid)
+                    return false;
+            }
+            else
+            {
+                property.type = plyTypeFromName(typeName);
+            }
+            if (property.type == PlyType::Invalid)
+                return false;
+
+            iss >> property.name;
+            elements.back().properties.push_back(property);
+        }
+        else if (keyword == "end_header")
+        {
+            bodyStart = p;
+            return hasFormat;
+        }
+        // "ply", "comment" and "obj_info" lines are ignored
+    }
+
+    return false;
+}
+
+int findProperty(const PlyElement& element, const char* const* names)
+{
+    for (size_t i = 0; i < element.properties.size(); ++i)
+        for (const char* const* n = names; *n; ++n)
+            if (element.properties[i].name == *n)
+                return static_cast<int>(i);
+    return -1;
+}
+
+int findFaceIndexProperty(const PlyElement& element)
+{
+    static const char* const names[] = {"vertex_indices", "vertex_index", nullptr};
+    int idx = findProperty(element, names);
+    if (idx >= 0 && !element.properties[idx].isList)
+        return -1;
+    return idx;
+}
+
+struct VertexLayout
+{
+    int x = -1, y = -1, z = -1;
+    int u = -1, v = -1;
+
+    explicit VertexLayout(const PlyElement& element)
+    {
+        static const char* const xNames[] = {"x", nullptr};
+        static const char* const yNames[] = {"y", nullptr};
+        static const char* const zNames[] = {"z", nullptr};
+        static const char* const uNames[] = {"u", "s", "texture_u", "texture_s", nullptr};
+        static const char* const vNames[] = {"v", "t", "texture_v", "texture_t", nullptr};
+        x = findProperty(element, xNames);
+        y = findProperty(element, yNames);
+        z = findProperty(element, zNames);
+        u = findProperty(element, uNames);
+        v = findProperty(element, vNames);
+    }
+
+    bool valid() const { return x >= 0 && y >= 0 && z >= 0; }
+    bool hasUVs() const { return u >= 0 && v >= 0; }
+};
+
+// ASCII: one line per element entry
+
+struct PlyTextChunk
+{
+    std::vector<vec3> vertices;
+    std::vector<vec3> uvs;
+    std::vector<int> indices;
+    bool ok = true;
+};
+
+void parsePlyVertexLines(const char* p, const char* end, const PlyElement& element, const VertexLayout& layout, PlyTextChunk& chunk)
+{
+    std::vector<float> values(element.properties.size(), 0.f);
+
+    while (p < end)
+    {
+        const char* le = lineEnd(p, end);
+
+        for (size_t i = 0; i < element.properties.size(); ++i)
+        {
+            const PlyProperty& property = element.properties[i];
+            if (property.isList)
+            {
+                long n;
+                if (!parseInt(p, le, n))
+                    chunk.ok = false;
+                for (long k = 0; k < n; ++k)
+                    p = skipToken(skipBlanks(p, le), le);
+            }
+            else if (!parseFloat(p, le, values[i]))
+            {
+                chunk.ok = false;
+            }
+        }
+
+        chunk.vertices.push_back(vec3(values[layout.x], values[layout.y], values[layout.z]));
+        if (layout.hasUVs())
+            chunk.uvs.push_back(vec3(values[layout.u], values[layout.v], 0.f));
+
+        p = (le < end) ? le + 1 : end;
+    }
+}
+
+void parsePlyFaceLines(const char* p, const char* end, const PlyElement& element, int indexProperty, PlyTextChunk& chunk)
+{
+    std::vector<int> face;
+
+    while (p < end)
+    {
+        const char* le = lineEnd(p, end);
+
+        for (size_t i = 0; i < element.properties.size(); ++i)
+        {
+            const PlyProperty& property = element.properties[i];
+            if (!property.isList)
+            {
+                p = skipToken(skipBlanks(p, le), le);
+                continue;
+            }
+
+            long n;
+            if (!parseInt(p, le, n) || n < 0)
+            {
+                chunk.ok = false;
+                break;
+            }
+
+            if (static_cast<int>(i) != indexProperty)
+            {
+                for (long k = 0; k < n; ++k)
+                    p = skipToken(skipBlanks(p, le), le);
+                continue;
+            }
+
+            face.clear();
+            for (long k = 0; k < n; ++k)
+            {
+                long idx;
+                if (!parseInt(p, le, idx))
+                    chunk.ok = false;
+                face.push_back(static_cast<int>(idx));
+            }
+
+            for (size_t k = 1; k + 1 < face.size(); ++k)
+            {
+                chunk.indices.push_back(face[0]);
+                chunk.indices.push_back(face[k]);
+                chunk.indices.push_back(face[k + 1]);
+            }
+        }
+
+        p = (le < end) ? le + 1 : end;
+    }
+}
+
+bool loadPlyAscii(const char* p, const char* end, const std::vector<PlyElement>& elements, Mesh& mesh, int numThreads)
+{
+    for (const PlyElement& element : elements)
+    {
+        // the element's entries are the next element.count lines
+        const char* sectionStart = p;
+        for (size_t i = 0; i < element.count; ++i)
+        {
+            if (p >= end)
+                return false;
+            p = nextLine(p, end);
+        }
+        const char* sectionEnd = p;
+
+        bool isVertex = (element.name == "vertex");
+        bool isFace = (element.name == "face");
+        if (!isVertex && !isFace)
+            continue;
+
+        VertexLayout layout(element);
+        int indexProperty = findFaceIndexProperty(element);
+        if ((isVertex && !layout.valid()) || (isFace && indexProperty < 0))
+            return false;
+
+        auto ranges = splitLines(sectionStart, sectionEnd, chunkCountFor(sectionEnd - sectionStart, numThreads));
+        std::vector<PlyTextChunk> chunks(ranges.size());
+
+        parallelFor(0, static_cast<int>(ranges.size()), numThreads, [&](int c)
+        {
+            if (isVertex)
+                parsePlyVertexLines(ranges[c].first, ranges[c].second, element, layout, chunks[c]);
+            else
+                parsePlyFaceLines(ranges[c].first, ranges[c].second, element, indexProperty, chunks[c]);
+        });
+
+        // stitch
+        std::vector<size_t> offsets(chunks.size() + 1, 0);
+        for (size_t c = 0; c < chunks.size(); ++c)
+        {
+            if (!chunks[c].ok)
+                return false;
+            offsets[c + 1] = offsets[c] + (isVertex ? chunks[c].vertices.size() : chunks[c].indices.size());
+        }
+
+        if (isVertex)
+        {
+            mesh.vertices.resize(offsets.back());
+            if (layout.hasUVs())
+                mesh.vertexUVs.resize(offsets.back());
+        }
+        else
+        {
+            mesh.triangleVertIndices.resize(offsets.back());
+        }
+
+        parallelFor(0, static_cast<int>(chunks.size()), numThreads, [&](int c)
+        {
+            if (isVertex)
+            {
+                std::copy(chunks[c].vertices.begin(), chunks[c].vertices.end(), mesh.vertices.begin() + offsets[c]);
+                std::copy(chunks[c].uvs.begin(), chunks[c].uvs.end(), mesh.vertexUVs.begin() + offsets[c]);
+            }
+            else
+            {
+                std::copy(chunks[c].indices.begin(), chunks[c].indices.end(), mesh.triangleVertIndices.begin() + offsets[c]);
+            }
+        });
+    }
+
+    return true;
+}
+
+// Binary: decoded straight from the mapping
+
+// byte size of one entry, or 0 if the element has list properties
+size_t fixedStride(const PlyElement& element, std::vector<size_t>& offsets)
+{
+    size_t stride = 0;
+    offsets.clear();
+    for (const PlyProperty& property : element.properties)
+    {
+        if (property.isList)
+            return 0;
+        offsets.push_back(stride);
+        stride += plyTypeSize(property.type);
+    }
+    return stride;
+}
+
+// Smallest byte size of one entry, lists counted as empty. An element whose count
+// cannot fit in the bytes left is rejected before anything is allocated for it.
+bool entriesFit(const PlyElement& element, const char* p, const char* end)
+{
+    size_t minSize = 0;
+    for (const PlyProperty& property : element.properties)
+        minSize += plyTypeSize(property.isList ? property.countType : property.type);
+    if (minSize == 0)
+        return true;
+    return element.count <= static_cast<size_t>(end - p) / minSize;
+}
+
+// Reads the length of a list and moves p past it. False if the length is negative, not
+// a whole number or more items than the bytes left could hold.
+bool readListLength(const char*& p, const char* end, const PlyProperty& property, bool swapBytes, size_t& n)
+{
+    const size_t countSize = plyTypeSize(property.countType);
+    if (p > end || countSize > static_cast<size_t>(end - p))
+        return false;
+    const double count = readBinaryValue(p, property.countType, swapBytes);
+    p += countSize;
+    const size_t maxItems = static_cast<size_t>(end - p) / plyTypeSize(property.type);
+    if (!(count >= 0.0) || count > static_cast<double>(maxItems) || count != static_cast<double>(static_cast<size_t>(count)))
+        return false;
+    n = static_cast<size_t>(count);
+    return true;
+}
+
+// advances p past one entry of an element with list properties
+bool skipBinaryEntry(const char*& p, const char* end, const PlyElement& element, bool swapBytes)
+{
+    for (const PlyProperty& property : element.properties)
+    {
+        if (property.isList)
+        {
+            size_t n;
+            if (!readListLength(p, end, property, swapBytes, n))
+                return false;
+            p += n * plyTypeSize(property.type);
+        }
+        else
+        {
+            p += plyTypeSize(property.type);
+        }
+        if (p > end)
+            return false;
+    }
+    return true;
+}
+
+bool loadPlyBinary(const char* p, const char* end, const std::vector<PlyElement>& elements, bool swapBytes, Mesh& mesh, int numThreads)
+{
+    for (const PlyElement& element : elements)
+    {
+        if (!entriesFit(element, p, end))
+            return false;
+
+        std::vector<size_t> offsets;
+        const size_t stride = fixedStride(element, offsets);
+
+        if (element.name == "vertex")
+        {
+            VertexLayout layout(element);
+            if (!layout.valid())
+                return false;
+
+            mesh.vertices.resize(element.count);
+            if (layout.hasUVs())
+                mesh.vertexUVs.resize(element.count);
+
+            if (stride == 0)
+            {
+                // list properties on vertices - walk entry by entry
+                for (size_t i = 0; i < element.count; ++i)
+                {
+                    const char* entry = p;
+                    if (!skipBinaryEntry(p, end, element, swapBytes))
+                        return false;
+
+                    float values[5] = {0.f, 0.f, 0.f, 0.f, 0.f};
+                    const int wanted[5] = {layout.x, layout.y, layout.z, layout.u, layout.v};
+                    const char* q = entry;
+                    for (size_t k = 0; k < element.properties.size(); ++k)
+                    {
+                        const PlyProperty& property = element.properties[k];
+                        if (property.isList)
+                        {
+                            // the entry was checked by skipBinaryEntry
+                            size_t n = 0;
+                            readListLength(q, end, property, swapBytes, n);
+                            q += n * plyTypeSize(property.type);
+                            continue;
+                        }
+                        for (int w = 0; w < 5; ++w)
+                            if (wanted[w] == static_cast<int>(k))
+                                values[w] = static_cast<float>(readBinaryValue(q, property.type, swapBytes));
+                        q += plyTypeSize(property.type);
+                    }
+
+                    mesh.vertices[i] = vec3(values[0], values[1], values[2]);
+                    if (layout.hasUVs())
+                        mesh.vertexUVs[i] = vec3(values[3], values[4], 0.f);
+                }
+                continue;
+            }
+
+            if (stride * element.count > static_cast<size_t>(end - p))
+                return false;
+
+            const PlyProperty& px = element.properties[layout.x];
+            const PlyProperty& py = element.properties[layout.y];
+            const PlyProperty& pz = element.properties[layout.z];
+
+            bool packedFloats = !swapBytes && stride == 3 * sizeof(float) && sizeof(vec3) == 3 * sizeof(float)
+                    && px.type == PlyType::Float32 && py.type == PlyType::Float32 && pz.type == PlyType::Float32
+                    && offsets[layout.x] == 0 && offsets[layout.y] == 4 && offsets[layout.z] == 8;
+
+            if (packedFloats && element.count > 0)
+            {
+                // identical layout to std::vector<vec3>
+                std::memcpy(&mesh.vertices[0], p, stride * element.count);
+            }
+            else
+            {
+                const char* base = p;
+                const int blockSize = 1 << 16;
+                int blocks = static_cast<int>((element.count + blockSize - 1) / blockSize);
+
+                parallelFor(0, blocks, numThreads, [&](int b)
+                {
+                    size_t first = static_cast<size_t>(b) * blockSize;
+                    size_t last = std::min(element.count, first + blockSize);
+                    for (size_t i = first; i < last; ++i)
+                    {
+                        const char* entry = base + i * stride;
+                        mesh.vertices[i] = vec3(static_cast<float>(readBinaryValue(entry + offsets[layout.x], px.type, swapBytes)),
+                                                static_cast<float>(readBinaryValue(entry + offsets[layout.y], py.type, swapBytes)),
+                                                static_cast<float>(readBinaryValue(entry + offsets[layout.z], pz.type, swapBytes)));
+                        if (layout.hasUVs())
+                        {
+                            const PlyProperty& pu = element.properties[layout.u];
+                            const PlyProperty& pv = element.properties[layout.v];
+                            mesh.vertexUVs[i] = vec3(static_cast<float>(readBinaryValue(entry + offsets[layout.u], pu.type, swapBytes)),
+                                                     static_cast<float>(readBinaryValue(entry + offsets[layout.v], pv.type, swapBytes)),
+                                                     0.f);
+                        }
+                    }
+                });
+            }
+
+            p += stride * element.count;
+        }
+        else if (element.name == "face")
+        {
+            int indexProperty = findFaceIndexProperty(element);
+            if (indexProperty < 0)
+                return false;
+
+            // faces are variable length, decoded in one pass
+            mesh.triangleVertIndices.reserve(element.count * 3);
+            std::vector<int> face;
+
+            for (size_t i = 0; i < element.count; ++i)
+            {
+                for (size_t k = 0; k < element.properties.size(); ++k)
+                {
+                    const PlyProperty& property = element.properties[k];
+                    const size_t itemSize = plyTypeSize(property.type);
+                    if (!property.isList)
+                    {
+                        p += itemSize;
+                        continue;
+                    }
+
+                    size_t n;
+                    if (!readListLength(p, end, property, swapBytes, n))
+                        return false;
+
+                    if (static_cast<int>(k) == indexProperty)
+                    {
+                        face.clear();
+                        for (size_t f = 0; f < n; ++f)
+                            face.push_back(static_cast<int>(readBinaryValue(p + f * itemSize, property.type, swapBytes)));
+
+                        for (size_t f = 1; f + 1 < face.size(); ++f)
+                        {
+                            mesh.triangleVertIndices.push_back(face[0]);
+                            mesh.triangleVertIndices.push_back(face[f]);
+                            mesh.triangleVertIndices.push_back(face[f + 1]);
+                        }
+                    }
+                    p += n * itemSize;
+                }
+                if (p > end)
+                    return false;
+            }
+        }
+        else
+        {
+            // unused element
+            if (stride > 0)
+            {
+                p += stride * element.count;
+            }
+            else
+            {
+                for (size_t i = 0; i < element.count; ++i)
+                    if (!skipBinaryEntry(p, end, element, swapBytes))
+                        return false;
+            }
+            if (p > end)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+bool indicesInRange(const Mesh& mesh)
+{
+    const int vertexCount = static_cast<int>(mesh.vertices.size());
+    for (int idx : mesh.triangleVertIndices)
+        if (idx < 0 || idx >= vertexCount)
+            return false;
+    return true;
+}
+
+bool hasExtension(const std::string& fileName, const std::string& ext)
+{
+    if (fileName.size() < ext.size())
+        return false;
+    std::string tail = fileName.substr(fileName.size() - ext.size());
+    std::transform(tail.begin(), tail.end(), tail.begin(), ::tolower);
+    return tail == ext;
+}
+
+}
+
+namespace krt
+{
+
+bool loadOBJ(const std::string& fileName, Mesh& mesh, int numThreads)
+{
+    if (numThreads <= 0)
+        numThreads = defaultThreadCount();
+
+    MappedFile file;
+    if (!file.open(fileName))
+    {
+        std::cerr << "Failed to open mesh file: " << fileName << std::endl;
+        return false;
+    }
+
+    auto ranges = splitLines(file.begin(), file.end(), chunkCountFor(file.size(), numThreads));
+    std::vector<ObjChunk> chunks(ranges.size());
+
+    parallelFor(0, static_cast<int>(ranges.size()), numThreads, [&](int c)
+    {
+        parseObjChunk(ranges[c].first, ranges[c].second, chunks[c]);
+    });
+
+    // prefix sums give each chunk's place in the stitched arrays
+    std::vector<size_t> vertexOffsets(chunks.size() + 1, 0);
+    std::vector<size_t> indexOffsets(chunks.size() + 1, 0);
+    for (size_t c = 0; c < chunks.size(); ++c)
+    {
+        if (!chunks[c].ok)
+        {
+            std::cerr << "Malformed OBJ file: " << fileName << std::endl;
+            return false;
+        }
+        vertexOffsets[c + 1] = vertexOffsets[c] + chunks[c].vertices.size();
+        indexOffsets[c + 1] = indexOffsets[c] + chunks[c].indices.size();
+    }
+
+    mesh.vertices.resize(vertexOffsets.back());
+    mesh.triangleVertIndices.resize(indexOffsets.back());
+
+    parallelFor(0, static_cast<int>(chunks.size()), numThreads, [&](int c)
+    {
+        std::copy(chunks[c].vertices.begin(), chunks[c].vertices.end(), mesh.vertices.begin() + vertexOffsets[c]);
+
+        const int base = static_cast<int>(vertexOffsets[c]);
+        int* out = &mesh.triangleVertIndices[0] + indexOffsets[c];
+        for (const ObjIndex& oi : chunks[c].indices)
+            *out++ = oi.relative ? base + oi.value : oi.value;
+
+        std::vector<vec3>().swap(chunks[c].vertices);
+        std::vector<ObjIndex>().swap(chunks[c].indices);
+    });
+
+    if (!indicesInRange(mesh))
+    {
+        std::cerr << "OBJ face index out of range: " << fileName << std::endl;
+        return false;
+    }
+
+    finalizeMesh(mesh);
+    return true;
+}
+
+bool loadPLY(const std::string& fileName, Mesh& mesh, int numThreads)
+{
+    if (numThreads <= 0)
+        numThreads = defaultThreadCount();
+
+    MappedFile file;
+    if (!file.open(fileName))
+    {
+        std::cerr << "Failed to open mesh file: " << fileName << std::endl;
+        return false;
+    }
+
+    PlyFormat format = PlyFormat::Ascii;
+    std::vector<PlyElement> elements;
+    const char* body = nullptr;
+    if (!parsePlyHeader(file, format, elements, body))
+    {
+        std::cerr << "Invalid PLY header: " << fileName << std::endl;
+        return false;
+    }
+
+    bool ok;
+    if (format == PlyFormat::Ascii)
+    {
+        ok = loadPlyAscii(body, file.end(), elements, mesh, numThreads);
+    }
+    else
+    {
+        bool fileIsLittleEndian = (format == PlyFormat::BinaryLittleEndian);
+        ok = loadPlyBinary(body, file.end(), elements, fileIsLittleEndian != hostIsLittleEndian(), mesh, numThreads);
+    }
+
+    if (!ok)
+    {
+        std::cerr << "Malformed PLY file: " << fileName << std::endl;
+        return false;
+    }
+
+    if (!indicesInRange(mesh))
+    {
+        std::cerr << "PLY face index out of range: " << fileName << std::endl;
+        return false;
+    }
+
+    finalizeMesh(mesh);
+    return true;
+}
+
+bool loadMeshFromFile(const std::string& fileName, Mesh& mesh, int numThreads)
+{
+    if (hasExtension(fileName, ".obj"))
+        return loadOBJ(fileName, mesh, numThreads);
+    if (hasExtension(fileName, ".ply"))
+        return loadPLY(fileName, mesh, numThreads);
+
+    std::cerr << "Unsupported mesh file: " << fileName << std::endl;
+    return false;
+}
+
+}
@@ -1,4 +1,5 @@
 #include <kanima/core/scene.h>
+#include <kanima/core/meshLoader.h>
 
 #include <vector>
 #include <fstream>
@@ -6,14 +7,389 @@
 #include <cassert>
 #include <algorithm>
 #include <memory>
+#include <chrono>
+#include <deque>
+#include <mutex>
 
 #include <kanima/rapidjson/rapidjson/document.h>
 #include <kanima/rapidjson/rapidjson/istreamwrapper.h>
+#include <kanima/util/parallelFor.h>
+#include <kanima/util/renderContext.h>
+#include <kanima/util/memoryPlacement.h>
+
+// helper functions not exposed outside
+namespace
+{
+
+using namespace krt;
+
+// meshes with more triangles than this split their own precompute across threads
+const size_t LARGE_MESH_TRIANGLES = 1 << 16;
+
+// BVH nodes with at least this many triangles build their two children as separate tasks
+const size_t PARALLEL_BVH_TRIANGLES = 1 << 14;
+
+// rays traced by this thread, see tracedRayCount
+thread_local uint64_t threadRayCount = 0;
+
+// relative paths in a scene file start at the scene file's directory
+std::string scenePath(const std::string& sceneFileName, const std::string& path)
+{
+    if (path.empty() || path[0] == '/')
+        return path;
+    size_t slash = sceneFileName.find_last_of('/');
+    if (slash == std::string::npos)
+        return path;
+    return sceneFileName.substr(0, slash + 1) + path;
+}
+
+double secondsSince(const std::chrono::high_resolution_clock::time_point& start)
+{
+    std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+    return duration.count();
+}
+
+// Plane hit followed by the three edge tests. Shared by the resident and the paged
+// leaves so both give the same hits. Sets t and p only for a hit closer than maxT.
+inline bool intersectTriangle(const Ray& ray, const vec3& v0, const vec3& v1, const vec3& v2, const vec3& normal,
+                              bool cullBackfaces, double maxT, double& t, vec3& p)
+{
+    if (cullBackfaces && normal.dot(ray.d) > EPSILON) return false; // backface culling
+
+    // proj is negative if the normal and ray are in opposite direction. positive if the directions are same
+    double proj = normal.dot(ray.d);
+    if (std::abs(proj) < EPSILON) return false; // parallel (normal is perpendicular to ray)
+
+    t = normal.dot(v0 - ray.o) / proj;
+    if (t < EPSILON || t > maxT) return false; // opposite direction
+
+    p = ray.o + ray.d * t;
+
+    vec3 e01 = v1 - v0;
+    vec3 e12 = v2 - v1;
+    vec3 e20 = v0 - v2;
+
+    if (normal.dot(e01.cross(p - v0)) < -EPSILON) return false;
+    if (normal.dot(e12.cross(p - v1)) < -EPSILON) return false;
+    if (normal.dot(e20.cross(p - v2)) < -EPSILON) return false;
+
+    return true;
+}
+
+// intersection data of the closest hit of a BVH traversal
+IntersectionData bvhHitData(Scene& scene, int hitObjectIdx, int hitTriangleIdx, vec3& hitPoint, const vec3& hitNormal)
+{
+    IntersectionData iData;
+    iData.hitPoint = hitPoint;
+    iData.hitPointNormal = hitNormal;
+    iData.material = &(scene.geometryObjects[hitObjectIdx].material);
+    iData.objectIdx = hitObjectIdx;
+    iData.triangleIdx = hitTriangleIdx;
+
+    iData.baryCentricCoords = scene.geometryObjects[hitObjectIdx].findBaryCentricCoords(hitPoint, hitTriangleIdx);
+    iData.interpolatedVertNormal = scene.geometryObjects[hitObjectIdx].findInterpolatedVertNormal(iData.baryCentricCoords, hitTriangleIdx);
+    return iData;
+}
+
+// Boxes whose entry lies this much (relative) beyond a ray's closest hit are skipped by
+// the packet traversal. Covers the rounding of the box and the triangle distances.
+const float PACKET_PRUNE_MARGIN = 1e-4f;
+
+// The rays of a packet in lanes, so a box is tested against all of them in one loop the
+// compiler can vectorize. Lanes past the packet's rays repeat the first one.
+struct PacketLanes
+{
+    float ox[RAY_PACKET_SIZE], oy[RAY_PACKET_SIZE], oz[RAY_PACKET_SIZE];
+    float invX[RAY_PACKET_SIZE], invY[RAY_PACKET_SIZE], invZ[RAY_PACKET_SIZE];
+    bool parallelX[RAY_PACKET_SIZE], parallelY[RAY_PACKET_SIZE], parallelZ[RAY_PACKET_SIZE];
+
+    // Frustum of rays with a common origin: the range of the inverse directions per
+    // axis. Unused axes have a ray parallel to them.
+    bool commonOrigin;
+    bool useAxis[3];
+    float invMin[3], invMax[3];
+
+    PacketLanes(const Ray* rays, int count)
+    {
+        commonOrigin = true;
+        for (int i = 0; i < RAY_PACKET_SIZE; i++)
+        {
+            const Ray& ray = rays[i < count ? i : 0];
+            ox[i] = ray.o.x;
+            oy[i] = ray.o.y;
+            oz[i] = ray.o.z;
+            // the same tests and divisions as AABB::rayIntersectBox
+            parallelX[i] = std::abs(ray.d.x) < EPSILON;
+            parallelY[i] = std::abs(ray.d.y) < EPSILON;
+            parallelZ[i] = std::abs(ray.d.z) < EPSILON;
+            invX[i] = parallelX[i] ? 0.0f : 1.0f / ray.d.x;
+            invY[i] = parallelY[i] ? 0.0f : 1.0f / ray.d.y;
+            invZ[i] = parallelZ[i] ? 0.0f : 1.0f / ray.d.z;
+            commonOrigin = commonOrigin && ox[i] == ox[0] && oy[i] == oy[0] && oz[i] == oz[0];
+        }
+
+        const float* inv[3] = {invX, invY, invZ};
+        const bool* parallel[3] = {parallelX, parallelY, parallelZ};
+        for (int a = 0; a < 3; a++)
+        {
+            useAxis[a] = true;
+            invMin[a] = inv[a][0];
+            invMax[a] = inv[a][0];
+            for (int i = 0; i < RAY_PACKET_SIZE; i++)
+            {
+                useAxis[a] = useAxis[a] && !parallel[a][i];
+                invMin[a] = std::min(invMin[a], inv[a][i]);
+                invMax[a] = std::max(invMax[a], inv[a][i]);
+            }
+        }
+    }
+
+    // True only if every ray misses the box. The slab distances of each ray lie between
+    // those of the extreme inverse directions, so one interval test covers the packet.
+    bool frustumMisses(const AABB& box) const
+    {
+        if (!commonOrigin)
+            return false;
+
+        const float lo[3] = {box.getMinVertex().x - ox[0], box.getMinVertex().y - oy[0], box.getMinVertex().z - oz[0]};
+        const float hi[3] = {box.getMaxVertex().x - ox[0], box.getMaxVertex().y - oy[0], box.getMaxVertex().z - oz[0]};
+        float tMin = -std::numeric_limits<float>::infinity();
+        float tMax = std::numeric_limits<float>::infinity();
+        for (int a = 0; a < 3; a++)
+        {
+            if (!useAxis[a])
+                continue;
+            const float p0 = lo[a] * invMin[a], p1 = lo[a] * invMax[a];
+            const float p2 = hi[a] * invMin[a], p3 = hi[a] * invMax[a];
+            tMin = std::max(tMin, std::min(std::min(p0, p1), std::min(p2, p3)));
+            tMax = std::min(tMax, std::max(std::max(p0, p1), std::max(p2, p3)));
+        }
+        return tMin > tMax || tMax <= 0.0f;
+    }
+
+    // Rays of the active mask that hit the box no farther than their closest hit.
+    // Gives the answers of AABB::rayIntersectBox.
+    uint32_t hitMask(const AABB& box, const double* closest, uint32_t active) const
+    {
+        const vec3& minv = box.getMinVertex();
+        const vec3& maxv = box.getMaxVertex();
+        const float inf = std::numeric_limits<float>::infinity();
+
+        bool hit[RAY_PACKET_SIZE];
+        for (int i = 0; i < RAY_PACKET_SIZE; i++)
+        {
+            float tMin = -inf;
+            float tMax = inf;
+            slab(minv.x, maxv.x, ox[i], invX[i], parallelX[i], tMin, tMax);
+            slab(minv.y, maxv.y, oy[i], invY[i], parallelY[i], tMin, tMax);
+            slab(minv.z, maxv.z, oz[i], invZ[i], parallelZ[i], tMin, tMax);
+            hit[i] = tMin <= tMax && tMax > 0.0f && tMin <= closest[i] * (1.0f + PACKET_PRUNE_MARGIN);
+        }
+
+        uint32_t mask = 0;
+        for (int i = 0; i < RAY_PACKET_SIZE; i++)
+            mask |= hit[i] ? (1u << i) : 0u;
+        return mask & active;
+    }
+
+    static void slab(float lo, float hi, float o, float inv, bool parallel, float& tMin, float& tMax)
+    {
+        const float inf = std::numeric_limits<float>::infinity();
+        const float t0 = (lo - o) * inv;
+        const float t1 = (hi - o) * inv;
+        // a parallel ray is inside the slab everywhere or nowhere
+        const bool inside = o >= lo && o <= hi;
+        const float near = parallel ? (inside ? -inf : inf) : std::min(t0, t1);
+        const float far = parallel ? (inside ? inf : -inf) : std::max(t0, t1);
+        tMin = std::max(near, tMin);
+        tMax = std::min(far, tMax);
+    }
+};
+
+// Top-level tree over the per-mesh trees in [first, last): median split of the
+// box centers along the widest axis, the mesh roots become the leaves.
+std::unique_ptr<BVHNode> buildTopLevelTree(std::vector<std::unique_ptr<BVHNode>>& roots, size_t first, size_t last)
+{
+    if (last - first == 1)
+        return std::move(roots[first]);
+
+    auto center = [](const std::unique_ptr<BVHNode>& node)
+    {
+        return (node->boundingBox.getMinVertex() + node->boundingBox.getMaxVertex()) * 0.5f;
+    };
+
+    vec3 lo = center(roots[first]);
+    vec3 hi = lo;
+    for (size_t i = first + 1; i < last; ++i)
+    {
+        vec3 c = center(roots[i]);
+        lo = vec3(std::min(lo.x, c.x), std::min(lo.y, c.y), std::min(lo.z, c.z));
+        hi = vec3(std::max(hi.x, c.x), std::max(hi.y, c.y), std::max(hi.z, c.z));
+    }
+
+    vec3 extent = hi - lo;
+    int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+    size_t mid = first + (last - first) / 2;
+    std::nth_element(roots.begin() + first, roots.begin() + mid, roots.begin() + last,
+        [&](const std::unique_ptr<BVHNode>& a, const std::unique_ptr<BVHNode>& b) {
+            vec3 ca = center(a);
+            vec3 cb = center(b);
+            if (axis == 0) return ca.x < cb.x;
+            if (axis == 1) return ca.y < cb.y;
+            return ca.z < cb.z;
+        });
+
+    auto node = std::unique_ptr<BVHNode>(new BVHNode());
+    node->left = buildTopLevelTree(roots, first, mid);
+    node->right = buildTopLevelTree(roots, mid, last);
+    node->boundingBox = node->left->boundingBox.merged(node->right->boundingBox);
+    return node;
+}
+
+// Meshes are handed to the thread pool as soon as they are parsed. The tasks compute
+// the normals and AABB and build the mesh's own BVH while the parser moves on to the
+// next object. finish() adds the meshes to the scene and joins the per-mesh trees
+// under a top-level tree.
+class MeshPipeline
+{
+private:
+    struct Task
+    {
+        Mesh* mesh;
+        std::unique_ptr<BVHNode>* root;
+        int meshIdx;
+        bool preprocess;
+    };
+
+    Scene& scene;
+    ThreadPool& pool;
+    int numThreads;
+    bool buildTrees;
+    const size_t firstMeshIdx;
+
+    // deques keep element addresses stable while the parser appends
+    std::deque<Mesh> meshes;
+    std::deque<std::unique_ptr<BVHNode>> roots;
+
+    std::mutex statsMutex;
+    ThreadPool::TaskGroup tasks;
+
+    void addTime(double& phase, double seconds)
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        phase += seconds;
+    }
+
+    void process(const Task& task)
+    {
+        Mesh& mesh = *task.mesh;
+        const int meshThreads = (mesh.triangleVertIndices.size() / 3 >= LARGE_MESH_TRIANGLES) ? numThreads : 1;
+
+        if (task.preprocess)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            mesh.computeTriangleNormals(meshThreads);
+            addTime(scene.loadStats.triangleNormalSeconds, secondsSince(start));
+
+            start = std::chrono::high_resolution_clock::now();
+            mesh.computeVertexNormals(meshThreads);
+            addTime(scene.loadStats.vertexNormalSeconds, secondsSince(start));
+
+            start = std::chrono::high_resolution_clock::now();
+            mesh.computeAABB(meshThreads);
+            addTime(scene.loadStats.aabbSeconds, secondsSince(start));
+        }
+
+        if (buildTrees && !mesh.triangleVertIndices.empty())
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            std::vector<Triangle> triangles = mesh.generateTriangleWithCentroidList(task.meshIdx);
+            *task.root = scene.buildBVHTree(triangles, 0);
+            addTime(scene.loadStats.meshBVHSeconds, secondsSince(start));
+        }
+    }
+
+public:
+    MeshPipeline(Scene& scene, ThreadPool& pool, int numThreads, bool buildTrees)
+        : scene(scene), pool(pool), numThreads(numThreads), buildTrees(buildTrees), firstMeshIdx(scene.geometryObjects.size())
+    {}
+
+    ~MeshPipeline()
+    {
+        pool.wait(tasks);
+    }
+
+    // only called from the parsing thread
+    void submit(Mesh& mesh, bool preprocess)
+    {
+        meshes.push_back(std::move(mesh));
+        roots.emplace_back();
+
+        Task task;
+        task.mesh = &meshes.back();
+        task.root = &roots.back();
+        task.meshIdx = static_cast<int>(firstMeshIdx + meshes.size() - 1);
+        task.preprocess = preprocess;
+
+        pool.submit(tasks, [this, task]() { process(task); });
+    }
+
+    void finish()
+    {
+        pool.wait(tasks);
+
+        scene.geometryObjects.reserve(firstMeshIdx + meshes.size());
+        for (Mesh& mesh : meshes)
+            scene.geometryObjects.push_back(std::move(mesh));
+
+        // an earlier tree does not cover the new meshes
+        if (!buildTrees || firstMeshIdx != 0)
+            return;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::unique_ptr<BVHNode>> meshRoots;
+        for (auto& root : roots)
+            if (root)
+                meshRoots.push_back(std::move(root));
+
+        if (!meshRoots.empty())
+            scene.bvhRoot = buildTopLevelTree(meshRoots, 0, meshRoots.size());
+        scene.loadStats.topLevelBVHSeconds = secondsSince(start);
+    }
+};
+
+}
 
 namespace krt
 {
 using namespace rapidjson;
 
+void SceneLoadStats::print(std::ostream& out) const
+{
+    out<<"Scene load times:"<<std::endl;
+    out<<"file read + JSON parse: "<<readSeconds<<" s"<<std::endl;
+    out<<"scene extraction: "<<extractSeconds<<" s"<<std::endl;
+    out<<"triangle normals: "<<triangleNormalSeconds<<" s"<<std::endl;
+    out<<"vertex normals: "<<vertexNormalSeconds<<" s"<<std::endl;
+    out<<"bounding boxes: "<<aabbSeconds<<" s"<<std::endl;
+    out<<"per-mesh BVHs: "<<meshBVHSeconds<<" s"<<std::endl;
+    out<<"top-level BVH: "<<topLevelBVHSeconds<<" s"<<std::endl;
+    out<<"waiting for mesh workers after parsing: "<<pipelineWaitSeconds<<" s"<<std::endl;
+    out<<"texture decode wait: "<<textureWaitSeconds<<" s"<<std::endl;
+    out<<"total: "<<totalSeconds<<" s"<<std::endl;
+}
+
+uint64_t tracedRayCount()
+{
+    return threadRayCount;
+}
+
+void countTracedRays(uint64_t rays)
+{
+    threadRayCount += rays;
+}
+
 Scene::Scene() : camera(1920.0f/1080.0f)
 {
     this->bgColor = Color(0, 0, 0);
@@ -27,6 +403,12 @@ Scene::Scene(const std::string& sceneFileName) : camera(1920.0f/1080.0f)
     parseSceneFile(sceneFileName);
 }
 
+Scene::Scene(const std::string& sceneFileName, RenderContext& context) : camera(1920.0f/1080.0f)
+{
+    ThreadPool::Binding binding(context.pool());
+    parseSceneFile(sceneFileName);
+}
+
 void Scene::addMesh(Mesh& mesh)
 {
     geometryObjects.push_back(mesh);
@@ -54,6 +436,10 @@ void Scene::addTexture(std::string &name, std::shared_ptr<Texture> texture)
 
 void Scene::parseSceneFile(const std::string &sceneFileName)
 {
+    auto loadStart = std::chrono::high_resolution_clock::now();
+    this->loadStats = SceneLoadStats();
+    const int numThreads = this->load_threads > 0 ? this->load_threads : defaultThreadCount();
+
     // default values for scene, camera
     this->bgColor = Color(0, 0, 0);
     this->height = 1080;
@@ -81,6 +467,9 @@ void Scene::parseSceneFile(const std::string &sceneFileName)
         std::cerr << "Parse error: " << doc.GetParseError() << std::endl;
     }
 
+    this->loadStats.readSeconds = secondsSince(loadStart);
+    auto extractStart = std::chrono::high_resolution_clock::now();
+
     // Settings
 
     if (doc.HasMember("settings"))
@@ -278,7 +667,9 @@ void Scene::parseSceneFile(const std::string &sceneFileName)
                         const std::string filePath = texture["file_path"].GetString();
 
                         assert(filePath.size() > 1 && "File path empty");
-                        this->textureMap[name] = std::make_shared<BitmapTexture>(name, filePath);
+                        // decoded in the background while the geometry is parsed
+                        BitmapImageFuture image = this->imageCache.request(BitmapTexture::fixPath(filePath));
+                        this->textureMap[name] = std::make_shared<BitmapTexture>(name, image);
                     }
                 }
             }
@@ -362,12 +753,25 @@ void Scene::parseSceneFile(const std::string &sceneFileName)
 
 
     // Objects
+    MeshPipeline pipeline(*this, currentThreadPool(), numThreads, this->build_bvh_on_load);
     if (doc.HasMember("objects") && doc["objects"].IsArray())
     {
         const auto& objs = doc.FindMember("objects")->value;
         for (const auto& obj : objs.GetArray())
         {
             Mesh mesh;
+            bool loadedFromFile = false;
+
+            // external .obj/.ply mesh, normals and AABB are computed by the loader
+            if (obj.HasMember("file_path") && obj["file_path"].IsString())
+            {
+                const std::string meshPath = scenePath(sceneFileName, obj["file_path"].GetString());
+                loadedFromFile = loadMeshFromFile(meshPath, mesh, numThreads);
+                assert(loadedFromFile && "Mesh file could not be loaded");
+                if (!loadedFromFile)
+                    continue;
+            }
+
             // vertices
             if (obj.HasMember("vertices") && obj["vertices"].IsArray())
             {
@@ -421,11 +825,7 @@ void Scene::parseSceneFile(const std::string &sceneFileName)
                 }
             }
 
-            mesh.computeTriangleNormals();
-            mesh.computeVertexNormals();
-            mesh.computeAABB();
-
-            this->addMesh(mesh);
+            pipeline.submit(mesh, !loadedFromFile);
         }
 
     } //objects
@@ -457,11 +857,34 @@ void Scene::parseSceneFile(const std::string &sceneFileName)
             }
         }
     } // lights
+
+    this->loadStats.extractSeconds = secondsSince(extractStart);
+
+    // wait for the mesh workers still running after the last object was parsed
+    auto pipelineWaitStart = std::chrono::high_resolution_clock::now();
+    pipeline.finish();
+    this->loadStats.pipelineWaitSeconds = secondsSince(pipelineWaitStart);
+
+    // wait for the image decodes started in the textures section. The pool wait runs
+    // queued decodes meanwhile, so a scene loaded inside a pool task cannot block on them.
+    auto textureWaitStart = std::chrono::high_resolution_clock::now();
+    this->imageCache.wait();
+    for (auto& texture : this->textureMap)
+    {
+        if (texture.second && texture.second->type == "bitmap")
+            std::static_pointer_cast<BitmapTexture>(texture.second)->waitForImage();
+    }
+    this->loadStats.textureWaitSeconds = secondsSince(textureWaitStart);
+
+    this->loadStats.totalSeconds = secondsSince(loadStart);
 }
 
 
 IntersectionData Scene::traceRay(const Ray &ray)
 {
+    ++threadRayCount;
+    assert(!this->geometryPager && "Paged geometry is only reachable through the BVH");
+
     // find shortest intersecting triangle
     // find the point of intersection
     // get the normal of triangle
@@ -563,24 +986,9 @@ double Scene::shortestIntersectionInNode(BVHNode* node,const Ray &ray, int &hitT
             const vec3& v2 = triangleMesh.vertices[triangleMesh.triangleVertIndices[triangleIdx*3 + 2]];
             const vec3& normal = triangleMesh.triangleNormals[triangleIdx];
 
-            if (cullBackfaces && normal.dot(ray.d) > EPSILON) continue; // backface culling
-
-            // proj is negative if the normal and ray are in opposite direction. positive if the directions are same
-            double proj = normal.dot(ray.d);
-            if (std::abs(proj) < EPSILON) continue; // parallel (normal is perpendicular to ray)
-
-            double t = normal.dot(v0 - ray.o) / proj;
-            if (t < EPSILON || t > minT) continue; // opposite direction
-
-            vec3 p = ray.o + ray.d * t;
-
-            vec3 e01 = v1 - v0;
-            vec3 e12 = v2 - v1;
-            vec3 e20 = v0 - v2;
-
-            if (normal.dot(e01.cross(p - v0)) < -EPSILON) continue;
-            if (normal.dot(e12.cross(p - v1)) < -EPSILON) continue;
-            if (normal.dot(e20.cross(p - v2)) < -EPSILON) continue;
+            double t;
+            vec3 p;
+            if (!intersectTriangle(ray, v0, v1, v2, normal, cullBackfaces, minT, t, p)) continue;
 
             if (t < minT)
             {
@@ -643,6 +1051,10 @@ double Scene::shortestIntersectionInNode(BVHNode* node,const Ray &ray, int &hitT
 
 IntersectionData Scene::traceRayBVH(const Ray &ray)
 {
+    ++threadRayCount;
+    if (this->geometryPager)
+        return this->traceRayPaged(ray);
+
     // find shortest intersecting triangle
     // find the point of intersection
     // get the normal of triangle
@@ -653,28 +1065,276 @@ IntersectionData Scene::traceRayBVH(const Ray &ray)
     vec3 hitNormal;
     int hitTriangleIdx = -1;
     int hitObjectIdx = -1;
-    Material* hitMaterial = nullptr;
     float shortestIntersection = -1.0;
 
     shortestIntersection = this->shortestIntersectionInNode(this->bvhRoot.get(), ray, hitTriangleIdx, hitObjectIdx, hitPoint, hitNormal);
 
     if (shortestIntersection > -EPSILON && hitObjectIdx > -1)
+        iData = bvhHitData(*this, hitObjectIdx, hitTriangleIdx, hitPoint, hitNormal);
+
+    return iData;
+}
+
+void Scene::tracePacketBVH(const Ray* rays, int count, IntersectionData* hits)
+{
+    assert(count > 0 && count <= RAY_PACKET_SIZE);
+
+    // paged leaves are read one ray at a time
+    if (this->geometryPager)
     {
-        hitMaterial = &(this->geometryObjects[hitObjectIdx].material);
-        iData.hitPoint = hitPoint;
-        iData.hitPointNormal = hitNormal;
-        iData.material = hitMaterial;
-        iData.objectIdx = hitObjectIdx;
-        iData.triangleIdx = hitTriangleIdx;
+        for (int i = 0; i < count; i++)
+            hits[i] = this->traceRayBVH(rays[i]);
+        return;
+    }
+    threadRayCount += count;
+
+    const PacketLanes lanes(rays, count);
+    double closest[RAY_PACKET_SIZE];
+    int hitTriangleIdx[RAY_PACKET_SIZE];
+    int hitObjectIdx[RAY_PACKET_SIZE];
+    vec3 hitPoint[RAY_PACKET_SIZE];
+    vec3 hitNormal[RAY_PACKET_SIZE];
+    for (int i = 0; i < RAY_PACKET_SIZE; i++)
+    {
+        closest[i] = 1/EPSILON;
+        hitTriangleIdx[i] = -1;
+        hitObjectIdx[i] = -1;
+    }
+
+    // Depth first with the left child first, like shortestIntersectionInNode, and a hit
+    // only replaces a strictly closer one, so every ray ends with the hit it would get alone
+    thread_local std::vector<std::pair<BVHNode*, uint32_t>> stack;
+    stack.clear();
+    stack.emplace_back(this->bvhRoot.get(), (1u << count) - 1);
+
+    while (!stack.empty())
+    {
+        BVHNode* node = stack.back().first;
+        const uint32_t active = stack.back().second;
+        stack.pop_back();
+
+        if (lanes.frustumMisses(node->boundingBox))
+            continue;
+        const uint32_t mask = lanes.hitMask(node->boundingBox, closest, active);
+        if (mask == 0)
+            continue;
+
+        // a single ray left, the packet has diverged
+        if ((mask & (mask - 1)) == 0)
+        {
+            int i = 0;
+            while (!(mask & (1u << i)))
+                i++;
+
+            int triangleIdx = -1;
+            int objectIdx = -1;
+            vec3 p;
+            vec3 n;
+            double t = this->shortestIntersectionInNode(node, rays[i], triangleIdx, objectIdx, p, n);
+            if (triangleIdx != -1 && t > -EPSILON && t < closest[i])
+            {
+                closest[i] = t;
+                hitTriangleIdx[i] = triangleIdx;
+                hitObjectIdx[i] = objectIdx;
+                hitPoint[i] = p;
+                hitNormal[i] = n;
+            }
+            continue;
+        }
+
+        if (node->left == nullptr && node->right == nullptr)
+        {
+            // every triangle is loaded once for the whole packet
+            for (auto& trianglePair : node->triangleIndices)
+            {
+                int meshIdx = trianglePair.first;
+                int triangleIdx = trianglePair.second;
+
+                Mesh& triangleMesh = this->geometryObjects[meshIdx];
+                const vec3& v0 = triangleMesh.vertices[triangleMesh.triangleVertIndices[triangleIdx*3]];
+                const vec3& v1 = triangleMesh.vertices[triangleMesh.triangleVertIndices[triangleIdx*3 + 1]];
+                const vec3& v2 = triangleMesh.vertices[triangleMesh.triangleVertIndices[triangleIdx*3 + 2]];
+                const vec3& normal = triangleMesh.triangleNormals[triangleIdx];
+
+                for (int i = 0; i < count; i++)
+                {
+                    if (!(mask & (1u << i)))
+                        continue;
+                    const Ray& ray = rays[i];
+                    if (ray.type == RayType::shadow && triangleMesh.material.type == MaterialType::Refractive)
+                        continue;
+                    bool cullBackfaces = (triangleMesh.material.type == MaterialType::Refractive || ray.type == RayType::shadow) ? false : true;
+
+                    double t;
+                    vec3 p;
+                    if (!intersectTriangle(ray, v0, v1, v2, normal, cullBackfaces, closest[i], t, p) || !(t < closest[i]))
+                        continue;
+
+                    closest[i] = t;
+                    hitPoint[i] = p;
+                    hitNormal[i] = normal;
+                    hitObjectIdx[i] = meshIdx;
+                    hitTriangleIdx[i] = triangleIdx;
+                }
+            }
+            continue;
+        }
+
+        if (node->right != nullptr)
+            stack.emplace_back(node->right.get(), mask);
+        if (node->left != nullptr)
+            stack.emplace_back(node->left.get(), mask);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        hits[i] = IntersectionData();
+        if (hitTriangleIdx[i] != -1)
+            hits[i] = bvhHitData(*this, hitObjectIdx[i], hitTriangleIdx[i], hitPoint[i], hitNormal[i]);
+    }
+}
+
+
+double Scene::shortestIntersectionInPagedNode(BVHNode* node, const Ray &ray, PagedTriangle &hitTriangle, vec3 &hitPoint)
+{
+    assert(node != nullptr);
+
+    if (!node->boundingBox.rayIntersectBox(ray))
+        return -1.0;
+
+    if (node->left == nullptr && node->right == nullptr)
+    {
+        double minT = 1/EPSILON;
+        bool hit = false;
+
+        std::shared_ptr<const GeometryPage> page = this->geometryPager->acquire(node->pageIdx);
+        const PagedTriangle* first = &page->triangles[node->pageFirst];
+
+        for (int i = 0; i < node->pageCount; i++)
+        {
+            const PagedTriangle& tri = first[i];
+
+            const MaterialType materialType = this->geometryObjects[tri.meshIdx].material.type;
+            // if the mesh's material is refractive, all the triangles in it can be ignored for shadow ray
+            if (ray.type == RayType::shadow && materialType == MaterialType::Refractive)
+                continue;
+
+            bool cullBackfaces = (materialType == MaterialType::Refractive || ray.type == RayType::shadow) ? false : true;
+
+            double t;
+            vec3 p;
+            if (!intersectTriangle(ray, tri.v0, tri.v1, tri.v2, tri.normal, cullBackfaces, minT, t, p)) continue;
+
+            if (t < minT)
+            {
+                minT = t;
+                hitPoint = p;
+                hitTriangle = tri;
+                hit = true;
+            }
+        }
+
+        return hit ? minT : -1.0;
+    }
+
+    double minDist = -1.0;
+    PagedTriangle childHitTriangle;
+    vec3 childHitPoint;
+
+    if (node->left != nullptr)
+    {
+        double t = this->shortestIntersectionInPagedNode(node->left.get(), ray, childHitTriangle, childHitPoint);
+        if (t > -EPSILON)
+        {
+            hitTriangle = childHitTriangle;
+            hitPoint = childHitPoint;
+            minDist = t;
+        }
+    }
+
+    if (node->right != nullptr)
+    {
+        double t = this->shortestIntersectionInPagedNode(node->right.get(), ray, childHitTriangle, childHitPoint);
+        if (t > -EPSILON && (minDist < 0 || t < minDist))
+        {
+            hitTriangle = childHitTriangle;
+            hitPoint = childHitPoint;
+            minDist = t;
+        }
+    }
+
+    return minDist;
+}
+
+
+IntersectionData Scene::traceRayPaged(const Ray &ray)
+{
+    IntersectionData iData;
+
+    PagedTriangle hitTriangle;
+    vec3 hitPoint;
+
+    double shortestIntersection = this->shortestIntersectionInPagedNode(this->bvhRoot.get(), ray, hitTriangle, hitPoint);
 
-        iData.baryCentricCoords = this->geometryObjects[hitObjectIdx].findBaryCentricCoords(hitPoint, hitTriangleIdx);
-        iData.interpolatedVertNormal = this->geometryObjects[hitObjectIdx].findInterpolatedVertNormal(iData.baryCentricCoords, hitTriangleIdx);
+    if (shortestIntersection > -EPSILON)
+    {
+        // the mesh arrays are gone, so everything shading needs is taken from the paged triangle
+        iData.hitPoint = hitPoint;
+        iData.hitPointNormal = hitTriangle.normal;
+        iData.material = &(this->geometryObjects[hitTriangle.meshIdx].material);
+        iData.objectIdx = hitTriangle.meshIdx;
+        iData.triangleIdx = hitTriangle.triangleIdx;
+
+        iData.baryCentricCoords = hitTriangle.findBaryCentricCoords(hitPoint);
+        iData.interpolatedVertNormal = hitTriangle.findInterpolatedVertNormal(iData.baryCentricCoords);
+        hitTriangle.findTextureUV(iData.baryCentricCoords, iData.textureU, iData.textureV);
+        iData.hasTextureUV = true;
     }
 
     return iData;
 }
 
 
+bool Scene::enablePagedGeometry(const std::string &pageFileName, size_t maxResidentBytes, int trianglesPerPage)
+{
+    assert(this->bvhRoot && "The BVH must be built before paging the geometry");
+
+    std::unique_ptr<GeometryPager> pager(new GeometryPager());
+    if (!pager->create(pageFileName, this->geometryObjects, this->bvhRoot.get(), maxResidentBytes, trianglesPerPage))
+    {
+        std::cerr << "Failed to create geometry page file: " << pageFileName << ", the geometry stays in memory" << std::endl;
+        return false;
+    }
+
+    this->geometryPager = std::move(pager);
+    return true;
+}
+
+
+Color Scene::getAlbedo(IntersectionData &iData)
+{
+    Mesh& mesh = this->geometryObjects[iData.objectIdx];
+
+    if (iData.hasTextureUV)
+        return mesh.material.albedoTex->getTextureAlbedo(iData.textureU, iData.textureV, iData.baryCentricCoords);
+
+    return mesh.getAlbedo(iData.baryCentricCoords, iData.triangleIdx);
+}
+
+
+void Scene::placeMemory(bool hugePages, bool interleave)
+{
+    for (const Mesh& mesh : this->geometryObjects)
+    {
+        placeArray(mesh.vertices, hugePages, interleave);
+        placeArray(mesh.triangleVertIndices, hugePages, interleave);
+        placeArray(mesh.triangleNormals, hugePages, interleave);
+        placeArray(mesh.vertexNormals, hugePages, interleave);
+        placeArray(mesh.vertexUVs, hugePages, interleave);
+    }
+}
+
+
 std::unique_ptr<BVHNode> Scene::buildBVHTree(std::vector<Triangle>& allTrianglesInParent, int depth = 0)
 {
     assert(!allTrianglesInParent.empty() && "No triangles to build a tree");
@@ -704,8 +1364,20 @@ std::unique_ptr<BVHNode> Scene::buildBVHTree(std::vector<Triangle>& allTriangles
     std::vector<Triangle> right(allTrianglesInParent.begin() + mid, allTrianglesInParent.end());
 
     assert(!left.empty() && !right.empty());
-    node->left = buildBVHTree(left, depth + 1);
-    node->right = buildBVHTree(right, depth + 1);
+    if (allTrianglesInParent.size() >= PARALLEL_BVH_TRIANGLES)
+    {
+        // the left subtree becomes a task, the right one is built here meanwhile
+        ThreadPool& pool = currentThreadPool();
+        ThreadPool::TaskGroup leftTask;
+        pool.submit(leftTask, [&]() { node->left = buildBVHTree(left, depth + 1); });
+        node->right = buildBVHTree(right, depth + 1);
+        pool.wait(leftTask);
+    }
+    else
+    {
+        node->left = buildBVHTree(left, depth + 1);
+        node->right = buildBVHTree(right, depth + 1);
+    }
 
     return node;
 }
@@ -0,0 +1,169 @@
+#include <kanima/sampler/blueNoiseSampler.h>
+#include <kanima/sampler/sobolSampler.h>
+#include <kanima/sampler/scramble.h>
+
+#include <cmath>
+
+// helper functions not exposed outside
+namespace
+{
+
+using namespace krt;
+
+// Void-and-cluster (Ulichney) on a torus: ranks every cell so that the cells of any rank
+// prefix are evenly spread. Energy updates are incremental, O(N) per step.
+class VoidAndCluster
+{
+private:
+    int size;
+    int n;
+    std::vector<float> kernel; // gaussian of the wrapped offset
+    std::vector<float> energy;
+    std::vector<char> occupied;
+
+public:
+    explicit VoidAndCluster(int size) : size(size), n(size * size), kernel(n), energy(n, 0.0f), occupied(n, 0)
+    {
+        const float sigma = 1.5f;
+        for (int dy = 0; dy < size; ++dy)
+        {
+            for (int dx = 0; dx < size; ++dx)
+            {
+                int wx = std::min(dx, size - dx);
+                int wy = std::min(dy, size - dy);
+                kernel[dy * size + dx] = std::exp(-(wx * wx + wy * wy) / (2.0f * sigma * sigma));
+            }
+        }
+    }
+
+    void set(int cell, bool value)
+    {
+        occupied[cell] = value;
+        const int cx = cell % size;
+        const int cy = cell / size;
+        const float sign = value ? 1.0f : -1.0f;
+        for (int y = 0; y < size; ++y)
+        {
+            const int dy = (y - cy + size) % size;
+            for (int x = 0; x < size; ++x)
+                energy[y * size + x] += sign * kernel[dy * size + (x - cx + size) % size];
+        }
+    }
+
+    bool isSet(int cell) const { return occupied[cell] != 0; }
+
+    int tightestCluster() const
+    {
+        int best = -1;
+        for (int i = 0; i < n; ++i)
+            if (occupied[i] && (best < 0 || energy[i] > energy[best]))
+                best = i;
+        return best;
+    }
+
+    int largestVoid() const
+    {
+        int best = -1;
+        for (int i = 0; i < n; ++i)
+            if (!occupied[i] && (best < 0 || energy[i] < energy[best]))
+                best = i;
+        return best;
+    }
+};
+
+std::vector<float> makeBlueNoiseMask(int size)
+{
+    const int n = size * size;
+    const int initialCount = n / 10;
+
+    // random initial points, relaxed by moving the tightest cluster into the largest void
+    VoidAndCluster pattern(size);
+    Pcg32 rng(0x2545f491u);
+    for (int placed = 0; placed < initialCount;)
+    {
+        int cell = static_cast<int>(rng.nextUInt() % n);
+        if (!pattern.isSet(cell))
+        {
+            pattern.set(cell, true);
+            placed++;
+        }
+    }
+    for (int step = 0; step < n; ++step)
+    {
+        int cluster = pattern.tightestCluster();
+        pattern.set(cluster, false);
+        int gap = pattern.largestVoid();
+        pattern.set(gap, true);
+        if (gap == cluster)
+            break;
+    }
+
+    std::vector<int> rank(n, -1);
+
+    // ranks of the initial points, the tightest cluster gets the highest
+    VoidAndCluster removing = pattern;
+    for (int r = initialCount - 1; r >= 0; --r)
+    {
+        int cluster = removing.tightestCluster();
+        removing.set(cluster, false);
+        rank[cluster] = r;
+    }
+
+    // the rest in the order of the largest voids
+    for (int r = initialCount; r < n; ++r)
+    {
+        int gap = pattern.largestVoid();
+        pattern.set(gap, true);
+        rank[gap] = r;
+    }
+
+    std::vector<float> mask(n);
+    for (int i = 0; i < n; ++i)
+        mask[i] = (rank[i] + 0.5f) / n;
+    return mask;
+}
+
+float wrap(float value)
+{
+    return value >= 1.0f ? value - 1.0f : value;
+}
+
+}
+
+namespace krt
+{
+
+BlueNoiseSampler::BlueNoiseSampler(uint32_t seed) : seed(seed), x(0), y(0), sampleIndex(0) {}
+
+const std::vector<float>& BlueNoiseSampler::mask()
+{
+    static const std::vector<float> blueNoise = makeBlueNoiseMask(MASK_SIZE);
+    return blueNoise;
+}
+
+void BlueNoiseSampler::startSample(int x, int y, int sampleIndex)
+{
+    this->x = x;
+    this->y = y;
+    this->sampleIndex = static_cast<uint32_t>(sampleIndex);
+}
+
+void BlueNoiseSampler::get2D(int dimension, uint32_t path, int split, int splitCount, float& u, float& v)
+{
+    // the same points in every pixel, only the shift differs
+    uint32_t decision = hashCombine(hashCombine(seed, static_cast<uint32_t>(dimension)), path);
+    SobolSampler::scrambledPoint(sampleIndex * splitCount + split, decision, u, v);
+
+    // every dimension pair reads the mask at its own offsets
+    const std::vector<float>& blueNoise = mask();
+    uint32_t offset = hashCombine(decision, 3);
+    int mx = (x + static_cast<int>(offset & 0xff)) % MASK_SIZE;
+    int my = (y + static_cast<int>((offset >> 8) & 0xff)) % MASK_SIZE;
+    u = wrap(u + blueNoise[my * MASK_SIZE + mx]);
+
+    mx = (x + static_cast<int>((offset >> 16) & 0xff)) % MASK_SIZE;
+    my = (y + static_cast<int>((offset >> 24) & 0xff)) % MASK_SIZE;
+    v = wrap(v + blueNoise[my * MASK_SIZE + mx]);
+}
+
+}
@@ -0,0 +1,22 @@
+#include <kanima/sampler/pcgSampler.h>
+
+namespace krt
+{
+
+PcgSampler::PcgSampler(uint32_t seed) : seed(seed), sampleKey(0) {}
+
+void PcgSampler::startSample(int x, int y, int sampleIndex)
+{
+    uint64_t pixel = (static_cast<uint64_t>(static_cast<uint32_t>(y)) << 32) | static_cast<uint32_t>(x);
+    sampleKey = mixBits(pixel ^ mixBits(static_cast<uint64_t>(static_cast<uint32_t>(sampleIndex))));
+}
+
+void PcgSampler::get2D(int dimension, uint32_t path, int split, int /*splitCount*/, float& u, float& v)
+{
+    uint64_t decision = (static_cast<uint64_t>(path) << 32) | ((static_cast<uint32_t>(dimension) << 20) ^ static_cast<uint32_t>(split));
+    rng.seed(sampleKey ^ mixBits(decision), seed);
+    u = rng.nextFloat();
+    v = rng.nextFloat();
+}
+
+}
@@ -0,0 +1,26 @@
+#include <kanima/sampler/sampler.h>
+#include <kanima/sampler/pcgSampler.h>
+#include <kanima/sampler/stratifiedSampler.h>
+#include <kanima/sampler/sobolSampler.h>
+#include <kanima/sampler/blueNoiseSampler.h>
+
+namespace krt
+{
+
+std::unique_ptr<Sampler> createSampler(SamplerType type, uint32_t seed, int samplesPerPixel)
+{
+    switch (type)
+    {
+    case SamplerType::Stratified:
+        return std::unique_ptr<Sampler>(new StratifiedSampler(seed, samplesPerPixel));
+    case SamplerType::Sobol:
+        return std::unique_ptr<Sampler>(new SobolSampler(seed));
+    case SamplerType::BlueNoise:
+        return std::unique_ptr<Sampler>(new BlueNoiseSampler(seed));
+    case SamplerType::Independent:
+    default:
+        return std::unique_ptr<Sampler>(new PcgSampler(seed));
+    }
+}
+
+}
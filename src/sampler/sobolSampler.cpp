@@ -0,0 +1,29 @@
+#include <kanima/sampler/sobolSampler.h>
+#include <kanima/sampler/scramble.h>
+
+namespace krt
+{
+
+SobolSampler::SobolSampler(uint32_t seed) : seed(seed), pixelKey(0), sampleIndex(0) {}
+
+void SobolSampler::startSample(int x, int y, int sampleIndex)
+{
+    pixelKey = hashCombine(hashCombine(seed, static_cast<uint32_t>(x)), static_cast<uint32_t>(y));
+    this->sampleIndex = static_cast<uint32_t>(sampleIndex);
+}
+
+void SobolSampler::get2D(int dimension, uint32_t path, int split, int splitCount, float& u, float& v)
+{
+    uint32_t scrambleSeed = hashCombine(hashCombine(pixelKey, static_cast<uint32_t>(dimension)), path);
+    scrambledPoint(sampleIndex * splitCount + split, scrambleSeed, u, v);
+}
+
+void SobolSampler::scrambledPoint(uint32_t index, uint32_t scrambleSeed, float& u, float& v)
+{
+    // a shuffled order keeps every prefix of 2^k points stratified
+    uint32_t shuffled = nestedUniformScramble(index, scrambleSeed);
+    u = toUnitFloat(nestedUniformScramble(sobolDimension0(shuffled), hashCombine(scrambleSeed, 1)));
+    v = toUnitFloat(nestedUniformScramble(sobolDimension1(shuffled), hashCombine(scrambleSeed, 2)));
+}
+
+}
@@ -0,0 +1,44 @@
+#include <kanima/sampler/stratifiedSampler.h>
+#include <kanima/sampler/scramble.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace krt
+{
+
+StratifiedSampler::StratifiedSampler(uint32_t seed, int samplesPerPixel)
+    : seed(seed), samplesPerPixel(std::max(1, samplesPerPixel)), pixelKey(0), sampleIndex(0) {}
+
+void StratifiedSampler::startSample(int x, int y, int sampleIndex)
+{
+    pixelKey = hashCombine(hashCombine(seed, static_cast<uint32_t>(x)), static_cast<uint32_t>(y));
+    this->sampleIndex = sampleIndex;
+}
+
+void StratifiedSampler::get2D(int dimension, uint32_t path, int split, int splitCount, float& u, float& v)
+{
+    // the same permutation for every sample of the pixel, so the samples share the strata
+    const uint32_t decision = hashCombine(hashCombine(pixelKey, static_cast<uint32_t>(dimension)), path);
+    const uint32_t jitter = hashCombine(decision, static_cast<uint32_t>(sampleIndex * splitCount + split));
+
+    const uint32_t count = static_cast<uint32_t>(samplesPerPixel) * static_cast<uint32_t>(splitCount);
+    const uint32_t index = static_cast<uint32_t>(sampleIndex) * splitCount + split;
+    if (index >= count)
+    {
+        u = toUnitFloat(hashCombine(jitter, 1));
+        v = toUnitFloat(hashCombine(jitter, 2));
+        return;
+    }
+
+    const uint32_t cellsX = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(count))));
+    const uint32_t cellsY = (count + cellsX - 1) / cellsX;
+    const uint32_t cell = permuteIndex(index, cellsX * cellsY, decision);
+
+    u = ((cell % cellsX) + toUnitFloat(hashCombine(jitter, 1))) / cellsX;
+    v = ((cell / cellsX) + toUnitFloat(hashCombine(jitter, 2))) / cellsY;
+    u = std::min(u, 0.99999994f);
+    v = std::min(v, 0.99999994f);
+}
+
+}
@@ -5,11 +5,9 @@ namespace krt
 
 Color constantShader(IntersectionData& intersectData, Scene& scene)
 {
-    const Material hitMaterial = *intersectData.material;
-
     const Color meshColor = scene.geometryObjects[intersectData.objectIdx].uniformColor;
 
-    Color albedo = scene.geometryObjects[intersectData.objectIdx].getAlbedo(intersectData.baryCentricCoords, intersectData.triangleIdx);
+    Color albedo = scene.getAlbedo(intersectData);
     const float albedoR = albedo.r;
     const float albedoG = albedo.g;
     const float albedoB = albedo.b;
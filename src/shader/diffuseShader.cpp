@@ -1,122 +1,139 @@
 #include <kanima/shader/diffuseShader.h>
 #include <kanima/shader/recursiveShader.h>
+#include <kanima/sampler/hemisphere.h>
 
 namespace krt
 {
 const double SHADOW_BIAS = 1e-3;
 const double RAY_HIT_BIAS = 1e-3;
 
-Color diffuseShader(const Ray& ray, IntersectionData& intersectData, Scene& scene, int max_depth)
+Color diffuseReflectance(IntersectionData& intersectData, Scene& scene)
 {
-    const Material hitMaterial = *intersectData.material;
-
-    Color albedo = scene.geometryObjects[intersectData.objectIdx].getAlbedo(intersectData.baryCentricCoords, intersectData.triangleIdx);
-    const float albedoR = albedo.r;
-    const float albedoG = albedo.g;
-    const float albedoB = albedo.b;
+    const Color albedo = scene.getAlbedo(intersectData);
+    const Color& meshColor = scene.geometryObjects[intersectData.objectIdx].uniformColor;
+    return Color(meshColor.r * albedo.r, meshColor.g * albedo.g, meshColor.b * albedo.b);
+}
 
-    Color pixelColor = Color(0, 0, 0);
+int giRayCount(const Ray& ray, const Scene& scene)
+{
+    if (scene.gi_ray_count <= 0)
+        return 0;
+    if (scene.gi_mode == GIMode::Path || (scene.gi_mode == GIMode::PrimarySplit && ray.afterDiffuse))
+        return 1;
+    return scene.gi_ray_count;
+}
 
-    // local hit matrix
-    vec3 rightAxis = ray.d.cross(intersectData.hitPointNormal).normalized();
-    vec3 upAxis = intersectData.hitPointNormal;
-    vec3 forwardAxis = rightAxis.cross(upAxis);
-    mat3 localHitMatrix = mat3(rightAxis, upAxis, forwardAxis);
+Ray giRay(const Ray& ray, IntersectionData& intersectData, const Color& reflectance, int i, int rayCount, Sampler& sampler)
+{
+    // cosine weighted around the normal on the side of the incoming ray
+    vec3 normal = intersectData.hitPointNormal;
+    if (ray.d.dot(normal) > 0)
+        normal = -1 * normal;
+    const Onb frame(normal);
+
+    float u, v;
+    sampler.get2D(bounceDimension(ray.pathDepth), ray.pathId, i, rayCount, u, v);
+    vec3 diffReflRayDir = frame.toWorld(sampleCosineHemisphere(u, v));
+
+    Ray diffReflRay = Ray(intersectData.hitPoint + normal * RAY_HIT_BIAS, diffReflRayDir, RayType::reflection, ray.pathDepth + 1,
+                          branchPath(ray.pathId, i), ray.throughput * reflectance * (1.0f / rayCount));
+    diffReflRay.afterDiffuse = true;
+    return diffReflRay;
+}
 
-    // global illumination
-    for (int i = 0; i < scene.gi_ray_count; i++)
-    {
-        float randomAngleInXY = M_PI * static_cast<float>(rand()) / RAND_MAX;
-        vec3 randomVecInXY = vec3(cos(randomAngleInXY), sin(randomAngleInXY), 0);
+Ray shadowRay(IntersectionData& intersectData, const Light& light, double& distanceToLight)
+{
+    vec3 shadowOrigin = intersectData.hitPoint + intersectData.hitPointNormal * SHADOW_BIAS;
+    vec3 shadowDir = (light.getPosition() - shadowOrigin).normalized();
+    distanceToLight = (light.getPosition() - shadowOrigin).length();
+    return Ray(shadowOrigin, shadowDir, RayType::shadow, 1);
+}
 
-        float randomAngleInXZ = 2 * M_PI * static_cast<float>(rand()) / RAND_MAX;
-        mat3 rotateAroundY = mat3(vec3(cos(randomAngleInXZ), 0, -sin(randomAngleInXZ)),
-                                  vec3(0, 1, 0),
-                                  vec3(sin(randomAngleInXZ), 0, cos(randomAngleInXZ))
-                                  );
+bool shadowRayBlocked(Scene& scene, const Ray& shadowRay, double distanceToLight)
+{
+    vec3 shadowHitPoint;
+    vec3 shadowDHitNormal;
+    int shadownHitTriangleIndex;
 
-        vec3 randVecInXYRotated = rotateAroundY.transpose() * randomVecInXY;
+    if (scene.useBVH)
+    {
+        IntersectionData t = scene.traceRayBVH(shadowRay);
 
-        vec3 diffReflRayDir = (localHitMatrix.transpose() * randVecInXYRotated).normalized();
-        vec3 diffReflRayOrg = intersectData.hitPoint + intersectData.hitPointNormal * RAY_HIT_BIAS;
+        if (t.objectIdx != -1)
+        {
+            shadowHitPoint = t.hitPoint;
+            double st = (shadowHitPoint - shadowRay.o).length();
+            if (st < distanceToLight && st > EPSILON)
+                return true;
+        }
+        return false;
+    }
 
-        Ray diffReflRay = Ray(diffReflRayOrg, diffReflRayDir, RayType::reflection, ray.pathDepth + 1);
+    countTracedRays(1);
+    for (const Mesh& mesh : scene.geometryObjects)
+    {
+        double st = mesh.intersectRay(shadowRay, shadownHitTriangleIndex, shadowHitPoint, shadowDHitNormal, false);
 
-        pixelColor = pixelColor + recursiveShader(diffReflRay, scene, max_depth);
+        // intersection before reaching light
+        if (st < distanceToLight && st > EPSILON)
+            return true;
     }
+    return false;
+}
 
+Color lightContribution(IntersectionData& intersectData, const Light& light, const Color& reflectance)
+{
+    vec3 lightDir = light.getPosition() - intersectData.hitPoint;
+    float sphereRadius = lightDir.length();
 
-    // Shadow ray
-    vec3 shadowOrigin = intersectData.hitPoint + intersectData.hitPointNormal * SHADOW_BIAS;
-
-    for (const Light& light : scene.lights)
-    {
-        vec3 shadowDir = (light.getPosition() - shadowOrigin).normalized();
+    float cosLaw = 0;
+    lightDir = lightDir.normalized();
+    if (intersectData.material->smoothShading)
+        cosLaw = std::max(0.0f, lightDir.dot(intersectData.interpolatedVertNormal));
+    else
+        cosLaw = std::max(0.0f, lightDir.dot(intersectData.hitPointNormal));
 
-        Ray shadowRay = Ray(shadowOrigin, shadowDir, RayType::shadow, 1);
+    float sphereArea = 4.0f * M_PI * sphereRadius * sphereRadius;
 
-        vec3 shadowHitPoint;
-        vec3 shadowDHitNormal;
-        int shadownHitTriangleIndex;
-        double distanceToLight = (light.getPosition() - shadowOrigin).length();
-        bool shadowReachLight = true;
+    return (reflectance * (cosLaw/sphereArea)) * light.getIntensity();
+}
 
-        if (scene.useBVH)
-        {
-            IntersectionData t = scene.traceRayBVH(shadowRay);
-
-            if (t.objectIdx != -1)
-            {
-                shadowHitPoint = t.hitPoint;
-                double st = (shadowHitPoint - shadowOrigin).length();
-                if (st < distanceToLight && st > EPSILON)
-                    shadowReachLight = false;
-            }
-        }
+Color diffuseDirectLight(IntersectionData& intersectData, Scene& scene, const Color& reflectance)
+{
+    Color pixelColor = Color(0, 0, 0);
 
-        else
-        {
-            for (const Mesh& mesh : scene.geometryObjects)
-            {
-                double st = mesh.intersectRay(shadowRay, shadownHitTriangleIndex, shadowHitPoint, shadowDHitNormal, false);
-
-                // intersection before reaching light
-                if (st < distanceToLight && st > EPSILON)
-                {
-                    shadowReachLight = false;
-                    break;
-                }
-            }
-        }
+    for (const Light& light : scene.lights)
+    {
+        double distanceToLight;
+        Ray ray = shadowRay(intersectData, light, distanceToLight);
 
         // add contribution of each light
-        if (shadowReachLight)
-        {
-            vec3 lightDir = light.getPosition() - intersectData.hitPoint;
-            float sphereRadius = lightDir.length();
-
-            float cosLaw = 0;
-            lightDir = lightDir.normalized();
-            if (hitMaterial.smoothShading)
-                cosLaw = std::max(0.0f, lightDir.dot(intersectData.interpolatedVertNormal));
-            else
-                cosLaw = std::max(0.0f, lightDir.dot(intersectData.hitPointNormal));
-
-            float sphereArea = 4.0f * M_PI * sphereRadius * sphereRadius;
+        if (!shadowRayBlocked(scene, ray, distanceToLight))
+            pixelColor = pixelColor + lightContribution(intersectData, light, reflectance);
+    }
 
-            float rContrib = scene.geometryObjects[intersectData.objectIdx].uniformColor.r * albedoR;
-            float gContrib = scene.geometryObjects[intersectData.objectIdx].uniformColor.g * albedoG;
-            float bContrib = scene.geometryObjects[intersectData.objectIdx].uniformColor.b * albedoB;
+    return pixelColor;
+}
 
-            pixelColor = pixelColor + (Color(rContrib, gContrib, bContrib) * (cosLaw/sphereArea)) * light.getIntensity();
-        }
+Color diffuseShader(const Ray& ray, IntersectionData& intersectData, Scene& scene, int max_depth, Sampler& sampler)
+{
+    const Color reflectance = diffuseReflectance(intersectData, scene);
 
-    } // lights loop end
+    Color pixelColor = Color(0, 0, 0);
 
-    pixelColor = pixelColor * (1.0f / (scene.gi_ray_count + 1));
+    // global illumination
+    const int rayCount = giRayCount(ray, scene);
+    if (rayCount > 0)
+    {
+        Color incoming = Color(0, 0, 0);
+        for (int i = 0; i < rayCount; i++)
+            incoming = incoming + recursiveShader(giRay(ray, intersectData, reflectance, i, rayCount, sampler), scene, max_depth, sampler);
 
+        // the lambertian cos / pi cancels against the pdf, leaving the reflectance
+        pixelColor = incoming * reflectance * (1.0f / rayCount);
+    }
 
-    return pixelColor;
+    return pixelColor + diffuseDirectLight(intersectData, scene, reflectance);
 }
 
 }
@@ -0,0 +1,116 @@
+#include <cassert>
+#include <vector>
+#include <kanima/shader/iterativeShader.h>
+#include <kanima/shader/recursiveShader.h>
+
+
+// helper functions not exposed outside
+namespace
+{
+
+using namespace krt;
+
+// the first ray's hit is traced here unless one is given
+Color followPaths(const Ray& ray, const IntersectionData* firstHit, Scene& scene, int max_depth, Sampler& sampler)
+{
+    // rays still to follow, kept by the thread so samples do not allocate
+    thread_local std::vector<Ray> pending;
+    pending.clear();
+    pending.push_back(ray);
+
+    Color pixelColor = Color(0, 0, 0);
+
+    while (!pending.empty())
+    {
+        Ray current = pending.back();
+        pending.pop_back();
+
+        // one path, until it leaves the scene or ends
+        for (;;)
+        {
+            if (current.pathDepth > max_depth)
+            {
+                pixelColor = pixelColor + current.throughput * scene.bgColor;
+                break;
+            }
+
+            float survival;
+            if (!continuePath(current, scene, sampler, survival))
+                break;
+            current.throughput = current.throughput * (1.0f / survival);
+
+            IntersectionData iData;
+            if (firstHit)
+                iData = *firstHit;
+            else
+                iData = scene.useBVH ? scene.traceRayBVH(current) : scene.traceRay(current);
+            firstHit = nullptr;
+
+            // no hit
+            if (iData.triangleIdx == -1)
+            {
+                pixelColor = pixelColor + current.throughput * scene.bgColor;
+                break;
+            }
+
+            assert(iData.material != nullptr);
+            const MaterialType type = iData.material->type;
+
+            if (type == MaterialType::Diffuse)
+            {
+                const Color reflectance = diffuseReflectance(iData, scene);
+                pixelColor = pixelColor + current.throughput * diffuseDirectLight(iData, scene, reflectance);
+
+                const int rayCount = giRayCount(current, scene);
+                if (rayCount == 0)
+                    break;
+                for (int i = rayCount - 1; i > 0; i--)
+                    pending.push_back(giRay(current, iData, reflectance, i, rayCount, sampler));
+                current = giRay(current, iData, reflectance, 0, rayCount, sampler);
+            }
+
+            else if (type == MaterialType::Reflective)
+            {
+                current = mirrorRay(current, iData, scene.getAlbedo(iData));
+            }
+
+            else if (type == MaterialType::Refractive)
+            {
+                Ray rays[2];
+                float weights[2];
+                if (refractiveRays(current, iData, scene, sampler, rays, weights) == 2)
+                    pending.push_back(rays[1]);
+                current = rays[0];
+            }
+
+            else if (type == MaterialType::Constant)
+            {
+                pixelColor = pixelColor + current.throughput * constantShader(iData, scene);
+                break;
+            }
+
+            else
+            {
+                assert(false&&"Invalid material");
+                break;
+            }
+        }
+    }
+
+    return pixelColor;
+}
+
+}
+
+namespace krt
+{
+Color iterativeShader(const Ray& ray, Scene& scene, int max_depth, Sampler& sampler)
+{
+    return followPaths(ray, nullptr, scene, max_depth, sampler);
+}
+
+Color iterativeShader(const Ray& ray, const IntersectionData& hit, Scene& scene, int max_depth, Sampler& sampler)
+{
+    return followPaths(ray, &hit, scene, max_depth, sampler);
+}
+}
@@ -1,29 +1,69 @@
 #include <cassert>
+#include <algorithm>
 #include <kanima/shader/recursiveShader.h>
 
 
-namespace krt
-{
-Color recursiveShader(const Ray& ray, Scene& scene, int max_depth)
+// helper functions not exposed outside
+namespace
 {
-    Color pixelColor = scene.bgColor;
 
+using namespace krt;
+
+// the hit is traced here unless one is given
+Color shadeRay(const Ray& ray, const IntersectionData* hit, Scene& scene, int max_depth, Sampler& sampler)
+{
     if (ray.pathDepth > max_depth)
     {
-        return pixelColor;
+        return scene.bgColor;
     }
 
+    float survival = 1.0f;
+    if (!continuePath(ray, scene, sampler, survival))
+        return Color(0, 0, 0);
+    Ray weightedRay = ray;
+    weightedRay.throughput = ray.throughput * (1.0f / survival);
+
     IntersectionData iData;
 
-    if (scene.useBVH)
-        iData = scene.traceRayBVH(ray);
+    if (hit)
+        iData = *hit;
+    else if (scene.useBVH)
+        iData = scene.traceRayBVH(weightedRay);
     else
-        iData = scene.traceRay(ray);
+        iData = scene.traceRay(weightedRay);
+
+    return shadeHit(weightedRay, iData, scene, max_depth, sampler) * (1.0f / survival);
+}
+
+}
 
+namespace krt
+{
+bool continuePath(const Ray& ray, const Scene& scene, Sampler& sampler, float& survival)
+{
+    survival = 1.0f;
+    if (ray.pathDepth == 1)
+        return true;
+
+    const float maxThroughput = std::max(ray.throughput.r, std::max(ray.throughput.g, ray.throughput.b));
+    // the throughput holds the split factor of GI rays, so a faint ray may be one of
+    // many siblings that matter together; it survives often enough to keep the mean
+    if (maxThroughput < scene.rr_min_throughput)
+        survival = maxThroughput / scene.rr_min_throughput;
+    else if (scene.rr_start_depth > 0 && ray.pathDepth > scene.rr_start_depth && maxThroughput < 1.0f)
+        survival = maxThroughput;
+    else
+        return true;
+
+    return sampler.get1D(rouletteDimension(ray.pathDepth), ray.pathId) < survival;
+}
+
+Color shadeHit(const Ray& ray, IntersectionData& iData, Scene& scene, int max_depth, Sampler& sampler)
+{
     // no hit
     if(iData.triangleIdx == -1)
     {
-        return pixelColor;
+        return scene.bgColor;
     }
 
     assert(iData.material != nullptr);
@@ -31,17 +71,17 @@ Color recursiveShader(const Ray& ray, Scene& scene, int max_depth)
 
     if (hitMaterial.type == MaterialType::Diffuse)
     {
-        return diffuseShader(ray, iData, scene, max_depth);
+        return diffuseShader(ray, iData, scene, max_depth, sampler);
     }
 
     else if (hitMaterial.type == MaterialType::Reflective)
     {
-        return reflectiveShader(ray, iData, scene, max_depth);
+        return reflectiveShader(ray, iData, scene, max_depth, sampler);
     }
 
     else if (hitMaterial.type == MaterialType::Refractive)
     {
-        return refractiveShader(ray, iData, scene, max_depth);
+        return refractiveShader(ray, iData, scene, max_depth, sampler);
     }
 
     else if (hitMaterial.type == MaterialType::Constant)
@@ -51,6 +91,15 @@ Color recursiveShader(const Ray& ray, Scene& scene, int max_depth)
 
     assert(false&&"Invalid material");
     return Color(0, 0, 0);
+}
 
+Color recursiveShader(const Ray& ray, Scene& scene, int max_depth, Sampler& sampler)
+{
+    return shadeRay(ray, nullptr, scene, max_depth, sampler);
+}
+
+Color recursiveShader(const Ray& ray, const IntersectionData& hit, Scene& scene, int max_depth, Sampler& sampler)
+{
+    return shadeRay(ray, &hit, scene, max_depth, sampler);
 }
 }
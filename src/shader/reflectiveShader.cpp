@@ -6,18 +6,22 @@ namespace krt
 
 const double REFLECTION_BIAS = 1e-3;
 
-Color reflectiveShader(const Ray& ray, IntersectionData& intersectData, Scene& scene, int max_depth)
+Ray mirrorRay(const Ray& ray, IntersectionData& intersectData, const Color& albedo)
 {
-    const Material hitMaterial = *intersectData.material;
-    Color albedo = scene.geometryObjects[intersectData.objectIdx].getAlbedo(intersectData.baryCentricCoords, intersectData.triangleIdx);
+    const vec3& normal = (intersectData.material->smoothShading) ? intersectData.interpolatedVertNormal : intersectData.hitPointNormal;
+    Ray reflectedR = ray.reflectedRay(normal, intersectData.hitPoint + (normal * REFLECTION_BIAS));
+    reflectedR.throughput = ray.throughput * albedo;
+    return reflectedR;
+}
+
+Color reflectiveShader(const Ray& ray, IntersectionData& intersectData, Scene& scene, int max_depth, Sampler& sampler)
+{
+    Color albedo = scene.getAlbedo(intersectData);
     const float albedoR = albedo.r;
     const float albedoG = albedo.g;
     const float albedoB = albedo.b;
 
-    const vec3& normal = (hitMaterial.smoothShading) ? intersectData.interpolatedVertNormal : intersectData.hitPointNormal;
-    const Ray reflectedR = ray.reflectedRay(normal, intersectData.hitPoint + (normal * REFLECTION_BIAS));
-
-    const Color reflectedColor = recursiveShader(reflectedR, scene, max_depth);
+    const Color reflectedColor = recursiveShader(mirrorRay(ray, intersectData, albedo), scene, max_depth, sampler);
 
     return Color(reflectedColor.r * albedoR,  reflectedColor.g * albedoG, reflectedColor.b * albedoB);
 }
@@ -7,7 +7,7 @@ const double REFLECTION_BIAS = 1e-3;
 
 namespace krt
 {
-Color refractiveShader(const Ray& ray, IntersectionData& intersectData, Scene& scene, int max_depth)
+int refractiveRays(const Ray& ray, IntersectionData& intersectData, Scene& scene, Sampler& sampler, Ray rays[2], float weights[2])
 {
     vec3 normal = (intersectData.material->smoothShading) ? intersectData.interpolatedVertNormal : intersectData.hitPointNormal;
 
@@ -33,6 +33,8 @@ Color refractiveShader(const Ray& ray, IntersectionData& intersectData, Scene& s
     float cosAlpha = -1 * ray.d.dot(normal);
     float sinAlpha = sqrt(1 - pow(cosAlpha, 2));
 
+    weights[0] = 1.0f;
+
     // angle of incidence < critical angle
     if (sinAlpha < n2/n1)
     {
@@ -43,20 +45,50 @@ Color refractiveShader(const Ray& ray, IntersectionData& intersectData, Scene& s
         vec3 A = cosBeta * -1 * normal;
         vec3 R = A + B;
 
-        Ray refractionRay(intersectData.hitPoint + (-1* normal * REFRACTION_BIAS), R, RayType::refraction, ray.pathDepth + 1);
-        Color refractionColor = recursiveShader(refractionRay, scene, max_depth);
+        float fresnel = 0.5 * std::pow(1.0 + dotIN, 5.0f);
+
+        // one branch, chosen with its weight, so the weight and the probability cancel
+        if (ray.pathDepth > scene.fresnel_branch_depth)
+        {
+            if (sampler.get1D(fresnelDimension(ray.pathDepth), ray.pathId) < fresnel)
+            {
+                rays[0] = ray.reflectedRay(normal, intersectData.hitPoint + (normal * REFLECTION_BIAS));
+                rays[0].pathId = branchPath(ray.pathId, 1);
+                return 1;
+            }
 
-        Ray reflectionRay = ray.reflectedRay(normal, intersectData.hitPoint + (normal * REFLECTION_BIAS));
-        Color reflectionColor = recursiveShader(reflectionRay, scene, max_depth);
+            rays[0] = Ray(intersectData.hitPoint + (-1* normal * REFRACTION_BIAS), R, RayType::refraction, ray.pathDepth + 1,
+                          branchPath(ray.pathId, 0), ray.throughput);
+            rays[0].afterDiffuse = ray.afterDiffuse;
+            return 1;
+        }
 
-        float fresnel = 0.5 * std::pow(1.0 + dotIN, 5.0f);
-        return (fresnel * reflectionColor) + ((1.0 - fresnel) * refractionColor);
+        rays[0] = Ray(intersectData.hitPoint + (-1* normal * REFRACTION_BIAS), R, RayType::refraction, ray.pathDepth + 1,
+                      branchPath(ray.pathId, 0), ray.throughput * (1.0f - fresnel));
+        rays[0].afterDiffuse = ray.afterDiffuse;
+        weights[0] = 1.0f - fresnel;
+
+        rays[1] = ray.reflectedRay(normal, intersectData.hitPoint + (normal * REFLECTION_BIAS));
+        rays[1].pathId = branchPath(ray.pathId, 1);
+        rays[1].throughput = ray.throughput * fresnel;
+        weights[1] = fresnel;
+        return 2;
     }
 
-    Ray reflectionRay = ray.reflectedRay(normal, intersectData.hitPoint + (normal * REFLECTION_BIAS)); // depth will be incremented
+    rays[0] = ray.reflectedRay(normal, intersectData.hitPoint + (normal * REFLECTION_BIAS)); // depth will be incremented
+    return 1;
+}
+
+Color refractiveShader(const Ray& ray, IntersectionData& intersectData, Scene& scene, int max_depth, Sampler& sampler)
+{
+    Ray rays[2];
+    float weights[2];
+    if (refractiveRays(ray, intersectData, scene, sampler, rays, weights) == 1)
+        return recursiveShader(rays[0], scene, max_depth, sampler);
 
-    Color reflectionColor = recursiveShader(reflectionRay, scene, max_depth);
-    return reflectionColor;
+    Color refractionColor = recursiveShader(rays[0], scene, max_depth, sampler);
+    Color reflectionColor = recursiveShader(rays[1], scene, max_depth, sampler);
 
+    return (weights[1] * reflectionColor) + (weights[0] * refractionColor);
 }
 }
@@ -0,0 +1,210 @@
+#include <cassert>
+#include <algorithm>
+#include <kanima/shader/wavefrontShader.h>
+#include <kanima/shader/recursiveShader.h>
+
+// helper functions not exposed outside
+namespace
+{
+
+using namespace krt;
+
+const int MATERIAL_TYPES = 4;
+
+struct QueuedRay
+{
+    Ray ray;
+    int sample; // index into the samples and colors
+};
+
+struct QueuedShadowRay
+{
+    Ray ray;
+    double distanceToLight;
+    Color contribution; // added to the sample's color if the light is reached
+    int sample;
+};
+
+// Rays taken from a generation's queue and shaded together. Their children are
+// shaded before the next chunk of the generation, so a queue holds at most the
+// children of one chunk.
+const size_t WAVEFRONT_CHUNK_RAYS = 4096;
+
+// Queues of one thread, kept between calls so a batch does not allocate
+struct WavefrontQueues
+{
+    std::vector<std::vector<QueuedRay>> generations; // rays waiting, the camera rays first
+    std::vector<QueuedRay> rays; // the chunk being shaded
+    std::vector<IntersectionData> hits;
+    std::vector<int> byMaterial;
+    std::vector<QueuedShadowRay> shadowRays;
+};
+
+void startSample(Sampler& sampler, const PixelSample& sample)
+{
+    sampler.startSample(sample.x, sample.y, sample.sample);
+}
+
+}
+
+namespace krt
+{
+void wavefrontShader(const std::vector<Ray>& cameraRays, const std::vector<PixelSample>& samples,
+                     Scene& scene, int max_depth, Sampler& sampler, std::vector<Color>& colors, bool cameraPackets)
+{
+    thread_local WavefrontQueues queues;
+    std::vector<std::vector<QueuedRay>>& generations = queues.generations;
+    std::vector<QueuedRay>& rays = queues.rays;
+    std::vector<IntersectionData>& hits = queues.hits;
+    std::vector<int>& byMaterial = queues.byMaterial;
+    std::vector<QueuedShadowRay>& shadowRays = queues.shadowRays;
+
+    colors.assign(cameraRays.size(), Color(0, 0, 0));
+    if (generations.empty())
+        generations.resize(1);
+    for (std::vector<QueuedRay>& queue : generations)
+        queue.clear();
+    for (size_t i = 0; i < cameraRays.size(); i++)
+        generations[0].push_back(QueuedRay{cameraRays[i], static_cast<int>(i)});
+
+    int generation = 0;
+    while (true)
+    {
+        // the deepest generation with waiting rays, like the stack of iterativeShader
+        while (generation >= 0 && generations[generation].empty())
+            generation--;
+        if (generation < 0)
+            break;
+
+        if (generations.size() < static_cast<size_t>(generation) + 2)
+            generations.resize(generation + 2);
+        std::vector<QueuedRay>& pending = generations[generation];
+        std::vector<QueuedRay>& nextRays = generations[generation + 1];
+        const bool cameraGeneration = (generation == 0);
+
+        // a chunk from the end keeps neighbouring camera rays together
+        const size_t first = pending.size() > WAVEFRONT_CHUNK_RAYS ? pending.size() - WAVEFRONT_CHUNK_RAYS : 0;
+        rays.assign(pending.begin() + first, pending.end());
+        pending.resize(first);
+
+        // path ends and russian roulette
+        size_t alive = 0;
+        for (size_t i = 0; i < rays.size(); i++)
+        {
+            QueuedRay& queued = rays[i];
+            if (queued.ray.pathDepth > max_depth)
+            {
+                colors[queued.sample] = colors[queued.sample] + queued.ray.throughput * scene.bgColor;
+                continue;
+            }
+
+            startSample(sampler, samples[queued.sample]);
+            float survival;
+            if (!continuePath(queued.ray, scene, sampler, survival))
+                continue;
+            queued.ray.throughput = queued.ray.throughput * (1.0f / survival);
+            rays[alive++] = queued;
+        }
+        rays.resize(alive);
+
+        // trace
+        hits.resize(rays.size());
+        if (cameraGeneration && cameraPackets && scene.useBVH)
+        {
+            Ray packet[RAY_PACKET_SIZE];
+            for (size_t first = 0; first < rays.size(); first += RAY_PACKET_SIZE)
+            {
+                const int count = static_cast<int>(std::min<size_t>(RAY_PACKET_SIZE, rays.size() - first));
+                for (int i = 0; i < count; i++)
+                    packet[i] = rays[first + i].ray;
+                scene.tracePacketBVH(packet, count, &hits[first]);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < rays.size(); i++)
+                hits[i] = scene.useBVH ? scene.traceRayBVH(rays[i].ray) : scene.traceRay(rays[i].ray);
+        }
+
+        // group the hits by material, misses get the background
+        int counts[MATERIAL_TYPES + 1] = {};
+        for (size_t i = 0; i < rays.size(); i++)
+        {
+            if (hits[i].triangleIdx == -1)
+            {
+                colors[rays[i].sample] = colors[rays[i].sample] + rays[i].ray.throughput * scene.bgColor;
+                continue;
+            }
+            assert(hits[i].material != nullptr);
+            counts[static_cast<int>(hits[i].material->type) + 1]++;
+        }
+        for (int m = 0; m < MATERIAL_TYPES; m++)
+            counts[m + 1] += counts[m];
+        byMaterial.resize(counts[MATERIAL_TYPES]);
+        for (size_t i = 0; i < rays.size(); i++)
+            if (hits[i].triangleIdx != -1)
+                byMaterial[counts[static_cast<int>(hits[i].material->type)]++] = static_cast<int>(i);
+        // the counts are now the ends of the groups
+        const int diffuseEnd = counts[static_cast<int>(MaterialType::Diffuse)];
+        const int reflectiveEnd = counts[static_cast<int>(MaterialType::Reflective)];
+        const int refractiveEnd = counts[static_cast<int>(MaterialType::Refractive)];
+        const int constantEnd = counts[static_cast<int>(MaterialType::Constant)];
+
+        shadowRays.clear();
+
+        // diffuse: shadow rays to every light and the GI rays
+        for (int k = 0; k < diffuseEnd; k++)
+        {
+            const QueuedRay& queued = rays[byMaterial[k]];
+            IntersectionData& iData = hits[byMaterial[k]];
+            const Color reflectance = diffuseReflectance(iData, scene);
+
+            for (const Light& light : scene.lights)
+            {
+                QueuedShadowRay shadow;
+                shadow.ray = shadowRay(iData, light, shadow.distanceToLight);
+                shadow.contribution = queued.ray.throughput * lightContribution(iData, light, reflectance);
+                shadow.sample = queued.sample;
+                shadowRays.push_back(shadow);
+            }
+
+            const int rayCount = giRayCount(queued.ray, scene);
+            if (rayCount > 0)
+                startSample(sampler, samples[queued.sample]);
+            for (int i = 0; i < rayCount; i++)
+                nextRays.push_back(QueuedRay{giRay(queued.ray, iData, reflectance, i, rayCount, sampler), queued.sample});
+        }
+
+        for (int k = diffuseEnd; k < reflectiveEnd; k++)
+        {
+            const QueuedRay& queued = rays[byMaterial[k]];
+            IntersectionData& iData = hits[byMaterial[k]];
+            nextRays.push_back(QueuedRay{mirrorRay(queued.ray, iData, scene.getAlbedo(iData)), queued.sample});
+        }
+
+        for (int k = reflectiveEnd; k < refractiveEnd; k++)
+        {
+            const QueuedRay& queued = rays[byMaterial[k]];
+            startSample(sampler, samples[queued.sample]);
+            Ray refracted[2];
+            float weights[2];
+            int count = refractiveRays(queued.ray, hits[byMaterial[k]], scene, sampler, refracted, weights);
+            for (int i = 0; i < count; i++)
+                nextRays.push_back(QueuedRay{refracted[i], queued.sample});
+        }
+
+        for (int k = refractiveEnd; k < constantEnd; k++)
+        {
+            const QueuedRay& queued = rays[byMaterial[k]];
+            colors[queued.sample] = colors[queued.sample] + queued.ray.throughput * constantShader(hits[byMaterial[k]], scene);
+        }
+
+        // lights that are not blocked
+        for (const QueuedShadowRay& shadow : shadowRays)
+            if (!shadowRayBlocked(scene, shadow.ray, shadow.distanceToLight))
+                colors[shadow.sample] = colors[shadow.sample] + shadow.contribution;
+
+        generation++;
+    }
+}
+}
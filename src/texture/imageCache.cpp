@@ -0,0 +1,98 @@
+#include <kanima/texture/imageCache.h>
+#include <kanima/stb_image/stb_image.h>
+#include <kanima/util/renderContext.h>
+
+#include <unistd.h>
+#include <cstdio>
+#include <iostream>
+
+namespace krt
+{
+
+BitmapImage::~BitmapImage()
+{
+    if (data)
+    {
+        stbi_image_free(data);
+    }
+}
+
+std::shared_ptr<const BitmapImage> BitmapImage::load(const std::string& filePath)
+{
+    std::shared_ptr<BitmapImage> image = std::make_shared<BitmapImage>();
+
+    image->data = stbi_load(filePath.c_str(), &image->width, &image->height, &image->channels, 3); // force 3 channels (RGB)
+    if (!image->data)
+    {
+        std::cerr << "Failed to load texture image: " << filePath << std::endl;
+        char buffer[1024];
+        if (getcwd(buffer, sizeof(buffer)) != NULL)
+            std::cout << "CWD: " << buffer << std::endl;
+        else
+            perror("getcwd() error");
+
+        image->width = image->height = image->channels = 0;
+    }
+    else
+    {
+        image->channels = 3;
+    }
+
+    return image;
+}
+
+
+ImageCache::ImageCache() : pool(nullptr) {}
+
+ImageCache::ImageCache(ThreadPool& pool) : pool(&pool) {}
+
+ImageCache::~ImageCache()
+{
+    wait();
+}
+
+BitmapImageFuture ImageCache::request(const std::string& filePath)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+
+    auto it = images.find(filePath);
+    if (it != images.end())
+        return it->second;
+
+    std::shared_ptr<std::promise<std::shared_ptr<const BitmapImage>>> result =
+            std::make_shared<std::promise<std::shared_ptr<const BitmapImage>>>();
+
+    BitmapImageFuture future = result->get_future().share();
+    images[filePath] = future;
+
+    if (!pool)
+        pool = &currentThreadPool();
+
+    pool->submit(decodes, [result, filePath]()
+    {
+        result->set_value(BitmapImage::load(filePath));
+    });
+
+    return future;
+}
+
+void ImageCache::wait()
+{
+    ThreadPool* decodePool;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        decodePool = pool;
+    }
+
+    if (decodePool)
+        decodePool->wait(decodes);
+}
+
+void ImageCache::clear()
+{
+    wait();
+    std::lock_guard<std::mutex> lock(mtx);
+    images.clear();
+}
+
+}
@@ -0,0 +1,257 @@
+#include <kanima/util/bucketScheduler.h>
+
+#include <algorithm>
+
+// helper functions not exposed outside
+namespace
+{
+
+using namespace krt;
+
+// position d along a Hilbert curve over an n x n grid, n a power of two
+void hilbertPoint(int n, int d, int& x, int& y)
+{
+    x = 0;
+    y = 0;
+    for (int s = 1; s < n; s *= 2)
+    {
+        int rx = 1 & (d / 2);
+        int ry = 1 & (d ^ rx);
+
+        // rotate the quadrant
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            std::swap(x, y);
+        }
+
+        x += s * rx;
+        y += s * ry;
+        d /= 4;
+    }
+}
+
+std::vector<std::pair<int, int>> hilbertOrder(int tilesX, int tilesY)
+{
+    int n = 1;
+    while (n < tilesX || n < tilesY)
+        n *= 2;
+
+    // walk the square curve and skip the tiles outside the image
+    std::vector<std::pair<int, int>> tiles;
+    tiles.reserve(tilesX * tilesY);
+    for (int d = 0; d < n * n; ++d)
+    {
+        int x, y;
+        hilbertPoint(n, d, x, y);
+        if (x < tilesX && y < tilesY)
+            tiles.emplace_back(x, y);
+    }
+    return tiles;
+}
+
+std::vector<std::pair<int, int>> spiralOrder(int tilesX, int tilesY)
+{
+    const int total = tilesX * tilesY;
+    std::vector<std::pair<int, int>> tiles;
+    tiles.reserve(total);
+
+    int x = (tilesX - 1) / 2;
+    int y = (tilesY - 1) / 2;
+    const int dx[4] = {1, 0, -1, 0};
+    const int dy[4] = {0, 1, 0, -1};
+
+    // legs of length 1, 1, 2, 2, 3, 3, ... turning after each leg
+    int dir = 0;
+    int legLength = 1;
+    while (static_cast<int>(tiles.size()) < total)
+    {
+        for (int leg = 0; leg < 2; ++leg)
+        {
+            for (int step = 0; step < legLength; ++step)
+            {
+                if (x >= 0 && x < tilesX && y >= 0 && y < tilesY)
+                    tiles.emplace_back(x, y);
+                x += dx[dir];
+                y += dy[dir];
+            }
+            dir = (dir + 1) % 4;
+        }
+        legLength++;
+    }
+    return tiles;
+}
+
+}
+
+namespace krt
+{
+
+std::vector<std::pair<int, int>> BucketScheduler::tileOrder(int tilesX, int tilesY, BucketOrder order)
+{
+    if (tilesX <= 0 || tilesY <= 0)
+        return std::vector<std::pair<int, int>>();
+
+    switch (order)
+    {
+    case BucketOrder::Hilbert:
+        return hilbertOrder(tilesX, tilesY);
+    case BucketOrder::Spiral:
+        return spiralOrder(tilesX, tilesY);
+    default:
+        break;
+    }
+
+    std::vector<std::pair<int, int>> tiles;
+    tiles.reserve(tilesX * tilesY);
+    for (int y = 0; y < tilesY; ++y)
+        for (int x = 0; x < tilesX; ++x)
+            tiles.emplace_back(x, y);
+    return tiles;
+}
+
+BucketScheduler::BucketScheduler(int imageWidth, int imageHeight, int bucketSize, BucketOrder order, int numWorkers)
+    : runCount(1), activeBuckets(0), completedBuckets(0)
+{
+    bucketSize = std::max(1, bucketSize);
+
+    const int tilesX = (imageWidth + bucketSize - 1) / bucketSize;
+    const int tilesY = (imageHeight + bucketSize - 1) / bucketSize;
+
+    for (const auto& tile : tileOrder(tilesX, tilesY, order))
+    {
+        int x = tile.first * bucketSize;
+        int y = tile.second * bucketSize;
+        int w = std::min(bucketSize, imageWidth - x);
+        int h = std::min(bucketSize, imageHeight - y);
+        buckets.push_back({x, y, w, h});
+    }
+
+    const int total = static_cast<int>(buckets.size());
+    states.reset(new BucketState[total]);
+    runCount = std::max(1, std::min(numWorkers, total));
+    runs.reset(new Run[runCount]);
+    reset();
+}
+
+void BucketScheduler::reset()
+{
+    std::vector<int> all(buckets.size());
+    for (size_t b = 0; b < buckets.size(); ++b)
+        all[b] = static_cast<int>(b);
+    reset(all);
+}
+
+void BucketScheduler::reset(const std::vector<int>& bucketIndices)
+{
+    active = bucketIndices;
+
+    for (int b = 0; b < static_cast<int>(buckets.size()); ++b)
+    {
+        states[b].started = false;
+        states[b].nextRow = 0;
+        states[b].rowsDone = 0;
+    }
+
+    const int total = static_cast<int>(active.size());
+    for (int r = 0; r < runCount; ++r)
+    {
+        runs[r].next = static_cast<int>(static_cast<long long>(total) * r / runCount);
+        runs[r].end = static_cast<int>(static_cast<long long>(total) * (r + 1) / runCount);
+    }
+
+    completedBuckets = 0;
+    activeBuckets = total;
+}
+
+bool BucketScheduler::next(int& bucketIdx, int& run)
+{
+    run = ((run % runCount) + runCount) % runCount;
+
+    while (true)
+    {
+        // relaxed is enough, the buckets are not written after construction
+        int idx = runs[run].next.fetch_add(1, std::memory_order_relaxed);
+        if (idx < runs[run].end)
+        {
+            bucketIdx = active[idx];
+            states[bucketIdx].started.store(true, std::memory_order_relaxed);
+            return true;
+        }
+
+        // own run is empty, continue in the run with the most buckets left
+        int best = -1;
+        int bestLeft = 0;
+        for (int r = 0; r < runCount; ++r)
+        {
+            int left = runs[r].end - runs[r].next.load(std::memory_order_relaxed);
+            if (left > bestLeft)
+            {
+                best = r;
+                bestLeft = left;
+            }
+        }
+
+        if (best < 0)
+            return false;
+        run = best;
+    }
+}
+
+bool BucketScheduler::steal(int& bucketIdx)
+{
+    // only happens at the end of a frame, a linear scan is cheap next to a row of pixels
+    int best = -1;
+    int bestLeft = 0;
+    for (int b = 0; b < static_cast<int>(buckets.size()); ++b)
+    {
+        if (!states[b].started.load(std::memory_order_relaxed))
+            continue;
+
+        int left = buckets[b].height - states[b].nextRow.load(std::memory_order_relaxed);
+        if (left > bestLeft)
+        {
+            best = b;
+            bestLeft = left;
+        }
+    }
+
+    if (best < 0)
+        return false;
+    bucketIdx = best;
+    return true;
+}
+
+bool BucketScheduler::claimRow(int bucketIdx, int& y)
+{
+    int row = states[bucketIdx].nextRow.fetch_add(1, std::memory_order_relaxed);
+    if (row >= buckets[bucketIdx].height)
+        return false;
+
+    y = buckets[bucketIdx].y + row;
+    return true;
+}
+
+bool BucketScheduler::finishRow(int bucketIdx)
+{
+    if (states[bucketIdx].rowsDone.fetch_add(1) + 1 < buckets[bucketIdx].height)
+        return false;
+
+    completedBuckets.fetch_add(1);
+    return true;
+}
+
+float BucketScheduler::progress() const
+{
+    // only atomics, progress is read while the last task of a pass resets the scheduler
+    const int total = activeBuckets.load();
+    if (total == 0)
+        return 1.0f;
+    return std::min(1.0f, static_cast<float>(completedBuckets.load()) / total);
+}
+
+}
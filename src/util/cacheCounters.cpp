@@ -0,0 +1,92 @@
+#include <kanima/util/cacheCounters.h>
+
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// helper functions not exposed outside
+namespace
+{
+
+#ifdef __linux__
+int openCounter(uint64_t config)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    // this thread, any cpu
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+uint64_t readCounter(int fd)
+{
+    uint64_t value = 0;
+    if (read(fd, &value, sizeof(value)) != sizeof(value))
+        return 0;
+    return value;
+}
+#endif
+
+}
+
+namespace krt
+{
+
+CacheCounters::CacheCounters() : referencesFd(-1), missesFd(-1) {}
+
+CacheCounters::~CacheCounters()
+{
+#ifdef __linux__
+    if (referencesFd >= 0)
+        close(referencesFd);
+    if (missesFd >= 0)
+        close(missesFd);
+#endif
+}
+
+bool CacheCounters::start()
+{
+#ifdef __linux__
+    if (referencesFd < 0)
+        referencesFd = openCounter(PERF_COUNT_HW_CACHE_REFERENCES);
+    if (missesFd < 0)
+        missesFd = openCounter(PERF_COUNT_HW_CACHE_MISSES);
+
+    if (referencesFd < 0 || missesFd < 0)
+        return false;
+
+    ioctl(referencesFd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(missesFd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(referencesFd, PERF_EVENT_IOC_ENABLE, 0);
+    ioctl(missesFd, PERF_EVENT_IOC_ENABLE, 0);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CacheCounters::stop()
+{
+#ifdef __linux__
+    if (referencesFd < 0 || missesFd < 0)
+        return;
+
+    ioctl(referencesFd, PERF_EVENT_IOC_DISABLE, 0);
+    ioctl(missesFd, PERF_EVENT_IOC_DISABLE, 0);
+    references += readCounter(referencesFd);
+    misses += readCounter(missesFd);
+#endif
+}
+
+}
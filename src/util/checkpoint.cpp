@@ -0,0 +1,91 @@
+#include <kanima/util/checkpoint.h>
+
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+
+const char MAGIC[8] = {'K', 'R', 'T', 'C', 'K', 'P', 'T', '\0'};
+const uint32_t VERSION = 1;
+
+template <typename T>
+void writeValue(std::ostream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& in, T& value)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+}
+
+namespace krt
+{
+
+bool writeCheckpoint(const std::string& fileName, const AccumulationBuffer& accumulation, const CheckpointInfo& info)
+{
+    const std::string tmpName = fileName + ".tmp";
+    bool written;
+    {
+        std::ofstream out(tmpName, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+
+        out.write(MAGIC, sizeof(MAGIC));
+        writeValue(out, VERSION);
+        writeValue(out, static_cast<int32_t>(accumulation.getWidth()));
+        writeValue(out, static_cast<int32_t>(accumulation.getHeight()));
+        writeValue(out, info.configHash);
+        writeValue(out, info.seed);
+        writeValue(out, static_cast<int32_t>(info.passes));
+
+        written = accumulation.write(out);
+        out.close();
+        written = written && out;
+    }
+
+    if (!written || std::rename(tmpName.c_str(), fileName.c_str()) != 0)
+    {
+        std::remove(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<AccumulationBuffer> readCheckpoint(const std::string& fileName, int width, int height,
+                                                   const CheckpointInfo& expected, CheckpointInfo& info, bool& otherSettings)
+{
+    otherSettings = false;
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in)
+        return nullptr;
+
+    char magic[sizeof(MAGIC)];
+    uint32_t version;
+    int32_t fileWidth, fileHeight, passes;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0
+            || !readValue(in, version) || version != VERSION
+            || !readValue(in, fileWidth) || !readValue(in, fileHeight)
+            || !readValue(in, info.configHash) || !readValue(in, info.seed) || !readValue(in, passes) || passes < 0)
+        return nullptr;
+
+    if (fileWidth != width || fileHeight != height || info.configHash != expected.configHash || info.seed != expected.seed)
+    {
+        otherSettings = true;
+        return nullptr;
+    }
+
+    std::unique_ptr<AccumulationBuffer> accumulation(new AccumulationBuffer(width, height));
+    if (!accumulation->read(in))
+        return nullptr;
+
+    info.passes = passes;
+    return accumulation;
+}
+
+}
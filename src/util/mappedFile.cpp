@@ -0,0 +1,57 @@
+#include <kanima/util/mappedFile.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace krt
+{
+
+MappedFile::MappedFile() : data(nullptr), length(0) {}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& fileName)
+{
+    close();
+
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* ptr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+
+    if (ptr == MAP_FAILED)
+        return false;
+
+    // files are mostly parsed front to back
+    madvise(ptr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+    data = static_cast<const char*>(ptr);
+    length = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data)
+    {
+        munmap(const_cast<char*>(data), length);
+        data = nullptr;
+        length = 0;
+    }
+}
+
+}
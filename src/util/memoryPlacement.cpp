@@ -0,0 +1,115 @@
+#include <kanima/util/memoryPlacement.h>
+
+#include <cstdint>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <fstream>
+#include <string>
+#endif
+
+// helper functions not exposed outside
+namespace
+{
+
+const uintptr_t HUGE_PAGE_SIZE = 2 << 20;
+
+// whole 2 MB pages inside [data, data + bytes), false if there are none
+bool hugePageRange(const void* data, size_t bytes, uintptr_t& first, uintptr_t& last)
+{
+    uintptr_t begin = reinterpret_cast<uintptr_t>(data);
+    first = (begin + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    last = (begin + bytes) & ~(HUGE_PAGE_SIZE - 1);
+    return last > first;
+}
+
+#ifdef __linux__
+// "0-3,8" style list from sysfs, returns the highest entry plus one
+int parseNodeList(const std::string& list)
+{
+    int count = 0;
+    size_t pos = 0;
+    while (pos < list.size())
+    {
+        size_t comma = list.find(',', pos);
+        std::string part = list.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        size_t dash = part.find('-');
+        int hi = std::stoi(dash == std::string::npos ? part : part.substr(dash + 1));
+        if (hi + 1 > count)
+            count = hi + 1;
+
+        if (comma == std::string::npos)
+            break;
+        pos = comma + 1;
+    }
+    return count;
+}
+#endif
+
+}
+
+namespace krt
+{
+
+int numaNodeCount()
+{
+#ifdef __linux__
+    static const int count = []()
+    {
+        std::ifstream in("/sys/devices/system/node/online");
+        std::string list;
+        if (!(in >> list) || list.empty())
+            return 1;
+        return parseNodeList(list);
+    }();
+    return count;
+#else
+    return 1;
+#endif
+}
+
+bool adviseHugePages(const void* data, size_t bytes)
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    uintptr_t first, last;
+    if (!hugePageRange(data, bytes, first, last))
+        return false;
+    return madvise(reinterpret_cast<void*>(first), last - first, MADV_HUGEPAGE) == 0;
+#else
+    (void)data;
+    (void)bytes;
+    return false;
+#endif
+}
+
+bool interleaveAcrossNodes(const void* data, size_t bytes)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+    const int nodes = numaNodeCount();
+    if (nodes <= 1 || nodes >= 64)
+        return false;
+
+    // mbind needs page aligned ranges
+    const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t first = (reinterpret_cast<uintptr_t>(data) + pageSize - 1) & ~(pageSize - 1);
+    uintptr_t last = (reinterpret_cast<uintptr_t>(data) + bytes) & ~(pageSize - 1);
+    if (last <= first)
+        return false;
+
+    // values from linux/mempolicy.h, not every libc ships that header
+    const int MPOL_INTERLEAVE_MODE = 3;
+    const unsigned MPOL_MF_MOVE_FLAG = 1 << 1;
+
+    unsigned long nodeMask = (1UL << nodes) - 1;
+    return syscall(SYS_mbind, first, last - first, MPOL_INTERLEAVE_MODE, &nodeMask,
+                   static_cast<unsigned long>(nodes + 1), MPOL_MF_MOVE_FLAG) == 0;
+#else
+    (void)data;
+    (void)bytes;
+    return false;
+#endif
+}
+
+}
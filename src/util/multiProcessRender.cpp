@@ -0,0 +1,374 @@
+#include <kanima/util/multiProcessRender.h>
+#include <kanima/util/bucketScheduler.h>
+#include <kanima/util/parallelFor.h>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include <cerrno>
+#include <deque>
+#include <chrono>
+#include <algorithm>
+
+// helper functions not exposed outside
+namespace
+{
+
+using namespace krt;
+
+// coordinator to worker, bucketIdx < 0 tells the worker to exit
+struct TileRequest
+{
+    int32_t bucketIdx;
+    int32_t x, y, width, height;
+};
+
+// worker to coordinator, followed by width * height colors
+struct TileResult
+{
+    int32_t bucketIdx;
+    int32_t width, height;
+};
+
+struct Worker
+{
+    pid_t pid = -1;
+    int fd = -1;
+    int bucketIdx = -1; // being rendered, -1 when idle
+    std::chrono::steady_clock::time_point tileStart;
+};
+
+bool sendAll(int fd, const void* data, size_t size)
+{
+    const char* p = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        // a dead worker must not kill the coordinator with SIGPIPE
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// gives up at deadline if one is given, a worker stopped halfway through a tile would
+// otherwise block the coordinator forever
+bool receiveAll(int fd, void* data, size_t size, const std::chrono::steady_clock::time_point* deadline = nullptr)
+{
+    char* p = static_cast<char*>(data);
+    while (size > 0)
+    {
+        if (deadline)
+        {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(*deadline - std::chrono::steady_clock::now());
+            if (remaining.count() < 0)
+                return false;
+            pollfd readable = {fd, POLLIN, 0};
+            int ready = poll(&readable, 1, static_cast<int>(remaining.count()) + 1);
+            if (ready < 0 && errno == EINTR)
+                continue;
+            if (ready <= 0)
+                return false;
+        }
+
+        ssize_t n = recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void workerLoop(int fd, Scene& scene, const RenderConfig& config)
+{
+    TileRequest request;
+    while (receiveAll(fd, &request, sizeof(request)) && request.bucketIdx >= 0)
+    {
+        Bucket bucket = {request.x, request.y, request.width, request.height};
+        PixelBuffer tile = renderBucket(scene, config, bucket);
+
+        TileResult result = {request.bucketIdx, request.width, request.height};
+        if (!sendAll(fd, &result, sizeof(result))
+                || !sendAll(fd, tile.data(), static_cast<size_t>(tile.getWidth()) * tile.getHeight() * sizeof(Color)))
+            return;
+    }
+}
+
+bool assign(Worker& worker, const BucketScheduler& buckets, int bucketIdx)
+{
+    const Bucket& b = buckets.bucket(bucketIdx);
+    TileRequest request = {bucketIdx, b.x, b.y, b.width, b.height};
+    worker.bucketIdx = bucketIdx;
+    worker.tileStart = std::chrono::steady_clock::now();
+    return sendAll(worker.fd, &request, sizeof(request));
+}
+
+bool receiveTile(Worker& worker, const BucketScheduler& buckets, PixelBuffer& image, double timeoutSeconds)
+{
+    std::chrono::steady_clock::time_point deadline = worker.tileStart
+        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeoutSeconds));
+    const std::chrono::steady_clock::time_point* tileDeadline = timeoutSeconds > 0 ? &deadline : nullptr;
+
+    TileResult result;
+    if (!receiveAll(worker.fd, &result, sizeof(result), tileDeadline) || result.bucketIdx != worker.bucketIdx)
+        return false;
+
+    const Bucket& b = buckets.bucket(result.bucketIdx);
+    if (result.width != b.width || result.height != b.height)
+        return false;
+
+    std::vector<Color> pixels(static_cast<size_t>(b.width) * b.height);
+    if (!receiveAll(worker.fd, &pixels[0], pixels.size() * sizeof(Color), tileDeadline))
+        return false;
+
+    for (int y = 0; y < b.height; ++y)
+        for (int x = 0; x < b.width; ++x)
+            image.setColor(b.x + x, b.y + y, pixels[y * b.width + x]);
+    return true;
+}
+
+void closeWorker(Worker& worker, std::deque<int>& retry)
+{
+    if (worker.bucketIdx >= 0)
+        retry.push_front(worker.bucketIdx);
+    worker.bucketIdx = -1;
+    close(worker.fd);
+    worker.fd = -1;
+}
+
+}
+
+namespace krt
+{
+
+PixelBuffer renderSceneMultiProcess(Scene& scene, RenderConfig& config, int numProcesses, RenderStats* stats)
+{
+    return renderSceneMultiProcess(RenderContext::defaultContext(), scene, config, numProcesses, stats);
+}
+
+PixelBuffer renderSceneMultiProcess(RenderContext& context, Scene& scene, RenderConfig& config, int numProcesses, RenderStats* stats)
+{
+    PixelBuffer image(config.buffer_width, config.buffer_height);
+    prepareSceneForRender(context, scene, config);
+
+    if (numProcesses <= 0)
+        numProcesses = defaultThreadCount();
+
+    BucketScheduler buckets(config.buffer_width, config.buffer_height, config.bucket_size, config.bucket_order);
+    if (config.print_info)
+        std::cout<<"Starting render with "<<numProcesses<<" processes, "<<buckets.bucketCount()<<" buckets"<<std::endl;
+
+    auto renderStart = std::chrono::high_resolution_clock::now();
+
+    std::vector<Worker> workers;
+    for (int i = 0; i < numProcesses; ++i)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+        {
+            std::cerr<<"Cannot create socket pair for render process "<<i<<std::endl;
+            break;
+        }
+
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            std::cerr<<"Cannot start render process "<<i<<std::endl;
+            close(fds[0]);
+            close(fds[1]);
+            break;
+        }
+
+        if (pid == 0)
+        {
+            close(fds[0]);
+            for (const Worker& other : workers)
+                close(other.fd);
+
+            workerLoop(fds[1], scene, config);
+
+            // the parent's pool threads do not exist here, skip every destructor
+            _exit(0);
+        }
+
+        close(fds[1]);
+        Worker worker;
+        worker.pid = pid;
+        worker.fd = fds[0];
+        workers.push_back(worker);
+    }
+
+    // buckets in render order, the ones of dead workers go first
+    std::deque<int> retry;
+    int nextBucket = 0;
+    int done = 0;
+    int lostWorkers = 0;
+    auto nextTile = [&](int& bucketIdx) {
+        if (!retry.empty())
+        {
+            bucketIdx = retry.front();
+            retry.pop_front();
+            return true;
+        }
+        if (nextBucket < buckets.bucketCount())
+        {
+            bucketIdx = nextBucket++;
+            return true;
+        }
+        return false;
+    };
+
+    // a worker that cannot take a tile is closed, its tile goes back to the others
+    auto feed = [&](Worker& worker) {
+        int bucketIdx;
+        while (worker.fd >= 0 && nextTile(bucketIdx))
+        {
+            if (assign(worker, buckets, bucketIdx))
+                return;
+            closeWorker(worker, retry);
+            lostWorkers++;
+        }
+    };
+
+    for (Worker& worker : workers)
+        feed(worker);
+
+    while (done < buckets.bucketCount())
+    {
+        std::vector<pollfd> fds;
+        std::vector<Worker*> busy;
+        for (Worker& worker : workers)
+        {
+            if (worker.fd >= 0 && worker.bucketIdx >= 0)
+            {
+                pollfd p = {worker.fd, POLLIN, 0};
+                fds.push_back(p);
+                busy.push_back(&worker);
+            }
+        }
+
+        if (fds.empty())
+        {
+            // idle survivors pick up the tiles of dead workers
+            bool fed = false;
+            for (Worker& worker : workers)
+            {
+                if (worker.fd >= 0)
+                {
+                    feed(worker);
+                    fed = fed || worker.bucketIdx >= 0;
+                }
+            }
+            if (fed)
+                continue;
+
+            // every worker is gone, the caller sees the missing buckets in the stats
+            break;
+        }
+
+        // wake up when the oldest tile runs out of time
+        int timeoutMs = -1;
+        if (config.tile_timeout_seconds > 0)
+        {
+            auto now = std::chrono::steady_clock::now();
+            double remaining = config.tile_timeout_seconds;
+            for (Worker* worker : busy)
+            {
+                std::chrono::duration<double> elapsed = now - worker->tileStart;
+                remaining = std::min(remaining, config.tile_timeout_seconds - elapsed.count());
+            }
+            timeoutMs = static_cast<int>(std::max(0.0, remaining) * 1000.0) + 1;
+        }
+
+        if (poll(&fds[0], fds.size(), timeoutMs) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            std::cerr<<"Waiting for render processes failed"<<std::endl;
+            break;
+        }
+
+        for (size_t i = 0; i < fds.size(); ++i)
+        {
+            Worker& worker = *busy[i];
+            if (fds[i].revents == 0)
+            {
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - worker.tileStart;
+                if (config.tile_timeout_seconds > 0 && elapsed.count() >= config.tile_timeout_seconds)
+                {
+                    // hung or far too slow, its tile goes to the others
+                    std::cerr<<"Render process "<<worker.pid<<" timed out on bucket "<<worker.bucketIdx<<std::endl;
+                    kill(worker.pid, SIGKILL);
+                    closeWorker(worker, retry);
+                    lostWorkers++;
+                }
+                continue;
+            }
+
+            if (!receiveTile(worker, buckets, image, config.tile_timeout_seconds))
+            {
+                // dead, or stalled mid-tile past the timeout
+                kill(worker.pid, SIGKILL);
+                closeWorker(worker, retry);
+                lostWorkers++;
+                continue;
+            }
+
+            worker.bucketIdx = -1;
+            done++;
+            if (config.print_info)
+                std::cout<< 100.0f * done / buckets.bucketCount() <<"% completed."<<std::endl;
+            feed(worker);
+        }
+
+        // tiles given back by a worker that died while others were idle
+        if (!retry.empty())
+            for (Worker& worker : workers)
+                if (worker.fd >= 0 && worker.bucketIdx < 0)
+                    feed(worker);
+    }
+
+    TileRequest stop = {-1, 0, 0, 0, 0};
+    for (Worker& worker : workers)
+    {
+        if (worker.fd >= 0)
+        {
+            sendAll(worker.fd, &stop, sizeof(stop));
+            close(worker.fd);
+        }
+        int status;
+        while (waitpid(worker.pid, &status, 0) < 0 && errno == EINTR) {}
+    }
+
+    std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - renderStart;
+    if (config.print_info)
+    {
+        std::cout<<"Completed render with "<<workers.size()<<" processes";
+        if (lostWorkers > 0)
+            std::cout<<", "<<lostWorkers<<" exited early";
+        if (done < buckets.bucketCount())
+            std::cout<<", "<<buckets.bucketCount() - done<<" buckets not rendered";
+        std::cout<<std::endl;
+        std::cout << "Time taken: " << duration.count() << " seconds\n";
+    }
+
+    if (stats)
+    {
+        *stats = RenderStats();
+        stats->renderSeconds = duration.count();
+        stats->bucketsLost = buckets.bucketCount() - done;
+    }
+    return image;
+}
+
+}
@@ -0,0 +1,20 @@
+#include <kanima/util/parallelFor.h>
+#include <kanima/util/renderContext.h>
+
+#include <thread>
+
+namespace krt
+{
+
+int defaultThreadCount()
+{
+    unsigned int n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : static_cast<int>(n);
+}
+
+void parallelFor(int begin, int end, int numThreads, const std::function<void(int)>& body)
+{
+    currentThreadPool().parallelFor(begin, end, body, numThreads);
+}
+
+}
@@ -0,0 +1,20 @@
+#include <kanima/util/renderContext.h>
+
+namespace krt
+{
+
+RenderContext::RenderContext(int numWorkers) : threadPool(numWorkers) {}
+
+RenderContext& RenderContext::defaultContext()
+{
+    static RenderContext context;
+    return context;
+}
+
+ThreadPool& currentThreadPool()
+{
+    ThreadPool* pool = ThreadPool::bound();
+    return pool ? *pool : RenderContext::defaultContext().pool();
+}
+
+}
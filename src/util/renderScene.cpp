@@ -1,4 +1,98 @@
 #include <kanima/util/renderScene.h>
+#include <kanima/util/bucketScheduler.h>
+#include <kanima/util/cacheCounters.h>
+#include <kanima/util/memoryPlacement.h>
+#include <kanima/util/accumulationBuffer.h>
+#include <kanima/util/checkpoint.h>
+#include <kanima/sampler/sampler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <condition_variable>
+#include <limits>
+#include <fstream>
+
+namespace krt
+{
+
+inline int adaptiveRoundSamples(const RenderConfig& config)
+{
+    return std::max(2, config.sample_per_pixel);
+}
+
+// Shared by the handle and the render tasks. Tasks leave the pool while the render
+// is paused, so no thread is held by a paused or queued render.
+struct RenderJobState
+{
+    RenderContext& context;
+    Scene& scene;
+    RenderConfig config;
+    PixelBuffer buffer;
+
+    std::unique_ptr<BucketScheduler> scheduler;
+    std::atomic<BucketScheduler*> publishedScheduler; // for progress() while setting up
+
+    // progressive and adaptive modes only, a pass adds one sample (progressive) or a
+    // round of samples (adaptive) to the pixels of its buckets
+    std::unique_ptr<AccumulationBuffer> accumulation;
+    int totalPasses = 1;
+    std::atomic<int> completedPasses;
+
+    // time budget, counted from the start of the job
+    bool hasDeadline = false;
+    std::chrono::high_resolution_clock::time_point jobStart;
+    std::chrono::high_resolution_clock::time_point deadline;
+
+    std::chrono::high_resolution_clock::time_point lastCheckpoint;
+
+    std::atomic<bool> cancelRequested;
+    std::atomic<bool> pauseRequested;
+    std::atomic<bool> completed; // finished without a cancel, also when adaptive rounds end early
+    ThreadPool::TaskGroup tasks;
+
+    // guards the fields below, taken when tasks start and leave, not per bucket
+    std::mutex mtx;
+    std::condition_variable stateChanged;
+    bool started = false; // scene prepared and scheduler created
+    bool finished = false;
+    bool betweenPasses = false; // on_pass_complete is running
+    int activeTasks = 0;
+    int numTasks = 1;
+    RenderStats stats;
+    std::chrono::high_resolution_clock::time_point renderStart;
+
+    RenderJobState(RenderContext& context, Scene& scene, const RenderConfig& config)
+        : context(context), scene(scene), config(config), buffer(config.buffer_width, config.buffer_height),
+          publishedScheduler(nullptr), completedPasses(0), cancelRequested(false), pauseRequested(false), completed(false)
+    {
+        jobStart = std::chrono::high_resolution_clock::now();
+
+        lastCheckpoint = jobStart;
+
+        if (config.progressive || config.time_budget_seconds > 0 || !config.checkpoint_file.empty() || config.adaptive_sampling)
+        {
+            accumulation.reset(new AccumulationBuffer(config.buffer_width, config.buffer_height));
+            totalPasses = std::max(1, config.sample_per_pixel);
+        }
+
+        if (config.adaptive_sampling)
+        {
+            const int round = adaptiveRoundSamples(config);
+            totalPasses = std::max(1, (std::max(config.max_spp, round) + round - 1) / round);
+        }
+
+        if (config.time_budget_seconds > 0)
+        {
+            hasDeadline = true;
+            totalPasses = std::numeric_limits<int>::max();
+            deadline = jobStart + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+                        std::chrono::duration<double>(config.time_budget_seconds));
+        }
+    }
+};
+
+}
 
 // helper functions not exposed outside
 namespace
@@ -6,91 +100,176 @@ namespace
 
 using namespace krt;
 
-struct Bucket
+Ray cameraRay(Scene& scene, Sampler& sampler, int x, int y, int sample, int imageWidth, int imageHeight)
 {
-    int x, y, width, height;
-};
+    sampler.startSample(x, y, sample);
 
-// Shared queue and mutex
-std::queue<Bucket> renderQueue;
-std::mutex queueMutex;
-int numberOfBuckets;
-bool printinfo = false;
+    float x_offset, y_offset;
+    sampler.get2D(CAMERA_DIMENSION, 0, 0, 1, x_offset, y_offset);
+    float u = (x + x_offset) / imageWidth;
+    float v = (y + y_offset) / imageHeight;
+    return scene.camera.generateRay(u, v);
+}
 
-void createBuckets(int imageWidth, int imageHeight, int bucketSize)
+// single samples of the wavefront integrator take the iterative one, it gives the same colors
+Color samplePixel(Scene& scene, Sampler& sampler, int x, int y, int sample, int imageWidth, int imageHeight, const RenderConfig& config)
 {
-    for (int y = 0; y < imageHeight; y += bucketSize)
-    {
-        for (int x = 0; x < imageWidth; x += bucketSize)
-        {
-            int w = std::min(bucketSize, imageWidth - x);
-            int h = std::min(bucketSize, imageHeight - y);
-           renderQueue.push({x, y, w, h});
-        }
+    Ray ray = cameraRay(scene, sampler, x, y, sample, imageWidth, imageHeight);
+
+    if (config.integrator == Integrator::Recursive)
+        return recursiveShader(ray, scene, config.ray_depth, sampler);
+    return iterativeShader(ray, scene, config.ray_depth, sampler);
+}
+
+Color renderPixel(Scene& scene, Sampler& sampler, int x, int y, int imageWidth, int imageHeight, const RenderConfig& config)
+{
+    Color pixelColor = Color(0, 0, 0);
+    for (int n = 0; n < config.sample_per_pixel; ++n)
+    { //AA
+        pixelColor = pixelColor + samplePixel(scene, sampler, x, y, n, imageWidth, imageHeight, config);
     }
-    numberOfBuckets = renderQueue.size();
+    return pixelColor * (1.0f / config.sample_per_pixel);
+}
+
+// Z of the 95% confidence interval used by adaptive sampling
+const float CONFIDENCE_Z = 1.96f;
+
+bool pixelConverged(const AccumulationBuffer& accumulation, int x, int y, const RenderConfig& config)
+{
+    int n = accumulation.getSampleCount(x, y);
+    if (n >= config.max_spp)
+        return true;
+    if (n < 2)
+        return false;
+
+    // relative to the mean, with a floor so that dark pixels do not need endless samples
+    float mean = AccumulationBuffer::luminance(accumulation.getColor(x, y));
+    float halfWidth = CONFIDENCE_Z * std::sqrt(accumulation.getLuminanceVariance(x, y) / n);
+    return halfWidth <= config.adaptive_threshold * std::max(mean, 0.01f);
 }
 
-void renderRegion(Scene& scene, PixelBuffer& buffer, int startX, int startY, int region_width, int region_height, int ray_depth, int sample_per_pixel)
+// camera samples the wavefront integrator collects into one batch
+const int WAVEFRONT_BATCH_SAMPLES = 4096;
+
+// colors of the samples with the configured integrator
+void shadeSamples(Scene& scene, Sampler& sampler, const std::vector<PixelSample>& samples, int imageWidth, int imageHeight,
+                  const RenderConfig& config, std::vector<Color>& colors)
 {
-    Camera& camera = scene.camera;
+    thread_local std::vector<Ray> cameraRays;
+    cameraRays.clear();
+    for (const PixelSample& sample : samples)
+        cameraRays.push_back(cameraRay(scene, sampler, sample.x, sample.y, sample.sample, imageWidth, imageHeight));
 
-    for (int y = startY; y < startY + region_height; ++y)
+    const bool packets = config.primary_ray_packets && scene.useBVH;
+    if (config.integrator == Integrator::Wavefront)
     {
-        for (int x = startX; x < startX + region_width; ++x)
-        {
-            Color pixelColor = Color(0, 0, 0);
-            for (int n = 0; n < sample_per_pixel; ++n)
-            { //AA
-                float x_offset = static_cast<float>(rand()) / RAND_MAX;
-                float y_offset = static_cast<float>(rand()) / RAND_MAX;
-                float u = (x + x_offset) / buffer.getWidth();
-                float v = (y + y_offset) / buffer.getHeight();
-                Ray ray = camera.generateRay(u, v);
+        wavefrontShader(cameraRays, samples, scene, config.ray_depth, sampler, colors, packets);
+        return;
+    }
 
-                pixelColor = pixelColor + recursiveShader(ray, scene, ray_depth);
-            }
-            buffer.setColor(x, y, pixelColor * (1.0f / sample_per_pixel));
+    // neighbouring samples, their camera rays are traced as one packet
+    colors.resize(samples.size());
+    IntersectionData hits[RAY_PACKET_SIZE];
+    for (size_t first = 0; first < samples.size(); first += RAY_PACKET_SIZE)
+    {
+        const int count = static_cast<int>(std::min<size_t>(RAY_PACKET_SIZE, samples.size() - first));
+        if (packets)
+            scene.tracePacketBVH(&cameraRays[first], count, hits);
+
+        for (int i = 0; i < count; i++)
+        {
+            const PixelSample& sample = samples[first + i];
+            const Ray& ray = cameraRays[first + i];
+            sampler.startSample(sample.x, sample.y, sample.sample);
+            if (config.integrator == Integrator::Recursive)
+                colors[first + i] = packets ? recursiveShader(ray, hits[i], scene, config.ray_depth, sampler)
+                                            : recursiveShader(ray, scene, config.ray_depth, sampler);
+            else
+                colors[first + i] = packets ? iterativeShader(ray, hits[i], scene, config.ray_depth, sampler)
+                                            : iterativeShader(ray, scene, config.ray_depth, sampler);
         }
     }
 }
 
-// Thread function
-void workerThread(Scene& scene, PixelBuffer& buffer, int ray_depth, int sample_per_pixel)
+// Renders rows of a bucket. Without an accumulation buffer every pixel gets
+// sample_per_pixel samples, averaged into the buffer. Progressive passes add one sample
+// per pixel, numbered by the samples it already has, and adaptive rounds add a round of
+// samples to each pixel that has not converged.
+void shadeRows(Scene& scene, Sampler& sampler, PixelBuffer& buffer, AccumulationBuffer* accumulation,
+               const Bucket& region, const std::vector<int>& rows, const RenderConfig& config)
 {
-    while (true)
+    thread_local std::vector<PixelSample> samples;
+    thread_local std::vector<Color> colors;
+    samples.clear();
+
+    const int imageWidth = accumulation ? accumulation->getWidth() : buffer.getWidth();
+    const int imageHeight = accumulation ? accumulation->getHeight() : buffer.getHeight();
+    const int round = adaptiveRoundSamples(config);
+    for (int y : rows)
     {
-        Bucket region;
+        for (int x = region.x; x < region.x + region.width; ++x)
         {
-            std::lock_guard<std::mutex> lock(queueMutex);
-            if (renderQueue.empty())
-                break;
+            int first = 0;
+            int end = config.sample_per_pixel;
+            if (accumulation)
+            {
+                first = accumulation->getSampleCount(x, y);
+                end = first + 1;
+                if (config.adaptive_sampling)
+                {
+                    if (pixelConverged(*accumulation, x, y, config))
+                        continue;
+                    end = std::min(first + round, std::max(config.max_spp, round));
+                }
+            }
+            for (int sample = first; sample < end; ++sample)
+                samples.push_back(PixelSample{x, y, sample});
+        }
+    }
 
-            region = renderQueue.front();
-            renderQueue.pop();
+    shadeSamples(scene, sampler, samples, imageWidth, imageHeight, config, colors);
 
-        }
-        renderRegion(scene, buffer, region.x, region.y, region.width, region.height, ray_depth, sample_per_pixel);
-        if (printinfo)
-            std::cout<< (1.0f - static_cast<float>(renderQueue.size()) / numberOfBuckets) * 100 <<"% completed."<<std::endl;
+    if (accumulation)
+    {
+        for (size_t i = 0; i < samples.size(); ++i)
+            accumulation->addSample(samples[i].x, samples[i].y, colors[i]);
+        return;
+    }
+
+    // the samples of a pixel are next to each other
+    for (size_t i = 0; i < samples.size(); i += config.sample_per_pixel)
+    {
+        Color pixelColor = Color(0, 0, 0);
+        for (int n = 0; n < config.sample_per_pixel; ++n)
+            pixelColor = pixelColor + colors[i + n];
+        buffer.setColor(samples[i].x, samples[i].y, pixelColor * (1.0f / config.sample_per_pixel));
     }
 }
 
-void bucketRender(Scene& scene, PixelBuffer& buffer, int numThreads, int bucketSize, int rayDepth, int sample_per_pixel)
+// tiles with pixels that need more samples, the ones with the most first
+std::vector<int> unconvergedTiles(const BucketScheduler& scheduler, const AccumulationBuffer& accumulation, const RenderConfig& config)
 {
-   createBuckets(scene.width, scene.height, bucketSize);
-   scene.bucketSize = bucketSize;
+    std::vector<std::pair<int, int>> open;
+    for (int b = 0; b < scheduler.bucketCount(); ++b)
+    {
+        const Bucket& tile = scheduler.bucket(b);
+        int pixels = 0;
+        for (int y = tile.y; y < tile.y + tile.height; ++y)
+            for (int x = tile.x; x < tile.x + tile.width; ++x)
+                if (!pixelConverged(accumulation, x, y, config))
+                    pixels++;
+        if (pixels > 0)
+            open.emplace_back(pixels, b);
+    }
 
-   std::vector<std::thread> threads;
-   for (int i = 0; i < numThreads; ++i)
-   {
-       threads.emplace_back(workerThread, std::ref(scene), std::ref(buffer), rayDepth, sample_per_pixel);
-   }
+    std::stable_sort(open.begin(), open.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+        return a.first > b.first;
+    });
 
-   for (auto& t : threads)
-   {
-       t.join();
-   }
+    std::vector<int> tiles;
+    for (const std::pair<int, int>& tile : open)
+        tiles.push_back(tile.second);
+    return tiles;
 }
 
 void buildBVHTree(Scene& scene, int min_triangles_per_bvhnode, int max_bvhtree_depth)
@@ -104,17 +283,34 @@ void buildBVHTree(Scene& scene, int min_triangles_per_bvhnode, int max_bvhtree_d
 }
 
 
+// samples per pixel the sampler is made for
+int samplerSamples(const RenderConfig& config)
+{
+    return config.adaptive_sampling ? config.max_spp : config.sample_per_pixel;
 }
 
-namespace krt
+const char* samplerName(SamplerType type)
 {
-PixelBuffer renderSceneToBuffer(Scene& scene, RenderConfig& config)
+    switch (type)
+    {
+    case SamplerType::Stratified: return "stratified";
+    case SamplerType::Sobol: return "sobol";
+    case SamplerType::BlueNoise: return "blue noise";
+    default: return "independent";
+    }
+}
+
+// scene setup that has to happen before the first bucket: tree, paging, placement
+void prepareScene(RenderContext& context, Scene& scene, const RenderConfig& config)
 {
-    PixelBuffer buffer(config.buffer_width, config.buffer_height);
     scene.height = config.buffer_height;
     scene.width = config.buffer_width;
     scene.gi_ray_count = config.gi_ray_count;
-    printinfo = config.print_info;
+    scene.gi_mode = config.gi_mode;
+    scene.rr_start_depth = config.rr_start_depth;
+    scene.rr_min_throughput = config.rr_min_throughput;
+    scene.fresnel_branch_depth = config.fresnel_branch_depth;
+    const bool printinfo = config.print_info;
 
     // config
     if (printinfo)
@@ -128,23 +324,54 @@ PixelBuffer renderSceneToBuffer(Scene& scene, RenderConfig& config)
         std::cout<<"min_triangles_per_leaf:"<<config.min_triangles_per_leaf<<std::endl;
         std::cout<<"buffer_width:"<<config.buffer_width<<std::endl;
         std::cout<<"buffer_height:"<<config.buffer_height<<std::endl;
-        std::cout<<"num_threads:"<<config.num_threads<<std::endl;
+        std::cout<<"num_threads:"<<config.num_threads<<" ("<<context.pool().workerCount()<<" pool workers)"<<std::endl;
         std::cout<<"bucket_size:"<<config.bucket_size<<std::endl;
+        std::cout<<"bucket_order:"<<(config.bucket_order == BucketOrder::Hilbert ? "hilbert" : (config.bucket_order == BucketOrder::Spiral ? "spiral" : "row major"))<<std::endl;
         std::cout<<"ray_depth:"<<config.ray_depth<<std::endl;
-        std::cout<<"gi_ray_count:"<<config.gi_ray_count<<std::endl;
-        std::cout<<"sample_per_pixel:"<<config.sample_per_pixel<<std::endl;
+        std::cout<<"gi_ray_count:"<<config.gi_ray_count<<" gi_mode:"<<(config.gi_mode == GIMode::Path ? "path" : (config.gi_mode == GIMode::PrimarySplit ? "primary split" : "split"))<<std::endl;
+        std::cout<<"rr_start_depth:"<<config.rr_start_depth<<" rr_min_throughput:"<<config.rr_min_throughput<<std::endl;
+        std::cout<<"fresnel_branch_depth:"<<config.fresnel_branch_depth<<std::endl;
+        std::cout<<"integrator:"<<(config.integrator == Integrator::Wavefront ? "wavefront" : (config.integrator == Integrator::Iterative ? "iterative" : "recursive"))
+                 <<(config.primary_ray_packets ? " (camera ray packets)" : "")<<std::endl;
+        std::cout<<"sample_per_pixel:"<<config.sample_per_pixel<<(config.progressive ? " (progressive)" : "")<<std::endl;
+        std::cout<<"sampler:"<<samplerName(config.sampler)<<std::endl;
+        if (config.adaptive_sampling)
+            std::cout<<"adaptive_threshold:"<<config.adaptive_threshold<<" max_spp:"<<config.max_spp<<std::endl;
+        if (config.time_budget_seconds > 0)
+            std::cout<<"time_budget_seconds:"<<config.time_budget_seconds<<std::endl;
+        if (config.pin_threads || config.numa_interleave || config.huge_pages)
+            std::cout<<"pin_threads:"<<config.pin_threads<<" numa_interleave:"<<config.numa_interleave<<" ("<<numaNodeCount()<<" nodes) huge_pages:"<<config.huge_pages<<std::endl;
+        if (config.paged_geometry)
+            std::cout<<"paged_geometry: "<<config.page_cache_mb<<" MB cache, "<<config.triangles_per_page<<" triangles per page"<<std::endl;
+
+        if (scene.loadStats.totalSeconds > 0)
+            scene.loadStats.print(std::cout);
     }
 
 
-    if (config.use_BVH)
+    // paged geometry can only be reached through the tree
+    scene.useBVH = config.use_BVH || config.paged_geometry || scene.geometryPager != nullptr;
+
+    if (scene.geometryPager)
     {
-        if (scene.bvhRoot == nullptr || config.rebuild_BVH)
+        if (printinfo)
+            std::cout<<"Geometry is paged, keeping the existing tree"<<std::endl;
+    }
+    else if (scene.useBVH)
+    {
+        // a tree built while loading uses the scene's leaf size and depth
+        bool treeParamsChanged = scene.min_triangles_per_bvhnode != config.min_triangles_per_leaf
+                || scene.max_bvhtree_depth != config.max_tree_depth;
+
+        if (scene.bvhRoot == nullptr || config.rebuild_BVH || treeParamsChanged)
         {
             if (printinfo)
                 std::cout<<"Building BVH tree start"<<std::endl;
+            auto bvhStart = std::chrono::high_resolution_clock::now();
             buildBVHTree(scene, config.min_triangles_per_leaf, config.max_tree_depth);
+            std::chrono::duration<double> bvhDuration = std::chrono::high_resolution_clock::now() - bvhStart;
             if (printinfo)
-                std::cout<<"Building BVH tree completed"<<std::endl;
+                std::cout<<"Building BVH tree completed in "<<bvhDuration.count()<<" seconds"<<std::endl;
         }
         else
         {
@@ -153,28 +380,601 @@ PixelBuffer renderSceneToBuffer(Scene& scene, RenderConfig& config)
         }
     }
 
-    if (printinfo)
+    if (config.paged_geometry && !scene.geometryPager)
+    {
+        auto pageStart = std::chrono::high_resolution_clock::now();
+        size_t cacheBytes = static_cast<size_t>(std::max(1, config.page_cache_mb)) << 20;
+        if (scene.enablePagedGeometry(config.geometry_page_file, cacheBytes, config.triangles_per_page) && printinfo)
+        {
+            std::chrono::duration<double> pageDuration = std::chrono::high_resolution_clock::now() - pageStart;
+            std::cout<<"Paging geometry completed in "<<pageDuration.count()<<" seconds, "
+                     <<scene.geometryPager->stats().pageCount<<" pages"<<std::endl;
+        }
+    }
+
+    if (scene.geometryPager)
+        scene.geometryPager->resetStats();
+
+    // never unpinned here, that would change the workers of other renders on the context
+    if (config.pin_threads)
+        context.pool().pinWorkers(true);
+
+    if (config.huge_pages || config.numa_interleave)
+        scene.placeMemory(config.huge_pages, config.numa_interleave);
+}
+
+void placeBuffer(const RenderConfig& config, PixelBuffer& buffer)
+{
+    size_t bufferBytes = static_cast<size_t>(buffer.getWidth()) * buffer.getHeight() * sizeof(Color);
+    if (config.huge_pages)
+        adviseHugePages(buffer.data(), bufferBytes);
+    if (config.numa_interleave)
+        interleaveAcrossNodes(buffer.data(), bufferBytes);
+}
+
+// passes over every tile before a time budget starts picking the noisy ones
+const int UNIFORM_PASSES = 2;
+
+bool deadlinePassed(const RenderJobState& job)
+{
+    // the first pass always completes, so every pixel has a sample
+    return job.hasDeadline && job.completedPasses.load() > 0
+            && std::chrono::high_resolution_clock::now() >= job.deadline;
+}
+
+// mean squared relative standard error of the tile's pixel luminance
+float tileNoise(const AccumulationBuffer& accumulation, const Bucket& tile)
+{
+    double noise = 0;
+    for (int y = tile.y; y < tile.y + tile.height; ++y)
+    {
+        for (int x = tile.x; x < tile.x + tile.width; ++x)
+        {
+            int n = accumulation.getSampleCount(x, y);
+            if (n == 0)
+                continue;
+
+            float mean = AccumulationBuffer::luminance(accumulation.getColor(x, y));
+            noise += accumulation.getLuminanceVariance(x, y) / n / (mean * mean + 1e-3f);
+        }
+    }
+    return static_cast<float>(noise / (tile.width * tile.height));
+}
+
+// the noisier half of the tiles, noisiest first so they are covered before the deadline
+std::vector<int> noisyTiles(const BucketScheduler& scheduler, const AccumulationBuffer& accumulation)
+{
+    std::vector<std::pair<float, int>> noise;
+    noise.reserve(scheduler.bucketCount());
+    for (int b = 0; b < scheduler.bucketCount(); ++b)
+        noise.emplace_back(tileNoise(accumulation, scheduler.bucket(b)), b);
+
+    std::sort(noise.begin(), noise.end(), [](const std::pair<float, int>& a, const std::pair<float, int>& b) {
+        return a.first > b.first;
+    });
+
+    std::vector<int> tiles;
+    size_t keep = std::max<size_t>(1, (noise.size() + 1) / 2);
+    for (size_t i = 0; i < keep && i < noise.size(); ++i)
+        tiles.push_back(noise[i].second);
+    return tiles;
+}
+
+float renderProgress(const RenderJobState& job)
+{
+    if (job.completed.load())
+        return 1.0f;
+
+    if (job.hasDeadline)
+    {
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - job.jobStart;
+        return static_cast<float>(std::min(1.0, elapsed.count() / job.config.time_budget_seconds));
+    }
+
+    BucketScheduler* scheduler = job.publishedScheduler.load();
+    if (!scheduler)
+        return 0.0f;
+
+    // progressive passes count as equal parts of the render
+    float progress = (job.completedPasses.load() + scheduler->progress()) / job.totalPasses;
+    return std::min(progress, 1.0f);
+}
+
+int32_t floatBits(float value)
+{
+    int32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// FNV-1a
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Settings and scene that change the samples; the tiling may differ on resume. The
+// scene is identified by its camera, lights, materials and mesh bounds, which are
+// kept when the geometry is paged out.
+uint64_t checkpointHash(const RenderConfig& config, const Scene& scene)
+{
+    uint64_t hash = 14695981039346656037ull;
+    // stratified samples depend on how many there are
+    const int32_t values[] = {config.buffer_width, config.buffer_height, config.ray_depth, config.gi_ray_count,
+                              static_cast<int32_t>(config.sampler),
+                              config.sampler == SamplerType::Stratified ? samplerSamples(config) : 0,
+                              config.adaptive_sampling ? config.max_spp : 0,
+                              config.rr_start_depth, floatBits(config.rr_min_throughput),
+                              config.fresnel_branch_depth, static_cast<int32_t>(config.gi_mode)};
+    hash = hashBytes(hash, values, sizeof(values));
+
+    std::vector<float> sceneValues;
+    // two corner rays cover the position, orientation and field of view
+    for (float corner : {0.0f, 1.0f})
+    {
+        Ray ray = scene.camera.generateRay(corner, corner);
+        sceneValues.insert(sceneValues.end(), {ray.o.x, ray.o.y, ray.o.z, ray.d.x, ray.d.y, ray.d.z});
+    }
+    sceneValues.insert(sceneValues.end(), {scene.bgColor.r, scene.bgColor.g, scene.bgColor.b});
+    for (const Light& light : scene.lights)
+    {
+        vec3 position = light.getPosition();
+        sceneValues.insert(sceneValues.end(), {position.x, position.y, position.z, light.getIntensity()});
+    }
+    for (const Mesh& mesh : scene.geometryObjects)
+    {
+        const vec3& minv = mesh.boundingBox.getMinVertex();
+        const vec3& maxv = mesh.boundingBox.getMaxVertex();
+        sceneValues.insert(sceneValues.end(), {minv.x, minv.y, minv.z, maxv.x, maxv.y, maxv.z,
+                                               static_cast<float>(mesh.material.type), mesh.material.ior});
+    }
+    return hashBytes(hash, sceneValues.data(), sceneValues.size() * sizeof(float));
+}
+
+void saveCheckpoint(RenderJobState& job, int passes)
+{
+    CheckpointInfo info;
+    info.configHash = checkpointHash(job.config, job.scene);
+    info.seed = job.config.seed;
+    info.passes = passes;
+
+    if (!writeCheckpoint(job.config.checkpoint_file, *job.accumulation, info))
+        std::cerr<<"Cannot write checkpoint "<<job.config.checkpoint_file<<std::endl;
+    else if (job.config.print_info)
+        std::cout<<"Checkpoint after "<<passes<<" passes written to "<<job.config.checkpoint_file<<std::endl;
+}
+
+// false if there is a checkpoint but it cannot be continued
+bool loadCheckpoint(RenderJobState& job)
+{
+    const RenderConfig& config = job.config;
+    std::ifstream exists(config.checkpoint_file);
+    if (!exists)
+    {
+        if (config.print_info)
+            std::cout<<"No checkpoint "<<config.checkpoint_file<<", starting from the first pass"<<std::endl;
+        return true;
+    }
+    exists.close();
+
+    CheckpointInfo expected;
+    expected.configHash = checkpointHash(config, job.scene);
+    expected.seed = config.seed;
+
+    CheckpointInfo info;
+    bool otherSettings;
+    std::unique_ptr<AccumulationBuffer> accumulation = readCheckpoint(config.checkpoint_file, config.buffer_width, config.buffer_height,
+                                                                      expected, info, otherSettings);
+    if (otherSettings)
+    {
+        std::cerr<<"Checkpoint "<<config.checkpoint_file<<" was written with other render settings or another scene"<<std::endl;
+        return false;
+    }
+    if (!accumulation)
+    {
+        std::cerr<<"Cannot read checkpoint "<<config.checkpoint_file<<std::endl;
+        return false;
+    }
+
+    job.accumulation = std::move(accumulation);
+    job.completedPasses = info.passes;
+    job.stats.resumedPasses = info.passes;
+    if (config.print_info)
+        std::cout<<"Resuming after "<<info.passes<<" passes from "<<config.checkpoint_file<<std::endl;
+    return true;
+}
+
+void finishJob(RenderJobState& job);
+void submitRenderTasks(const std::shared_ptr<RenderJobState>& job);
+
+void renderTask(const std::shared_ptr<RenderJobState>& job, int workerIdx)
+{
+    const RenderConfig& config = job->config;
+    BucketScheduler& scheduler = *job->scheduler;
+
+    // the pool threads outlive the render, so the counters cover this task only
+    CacheCounters counters;
+    bool counting = config.count_cache_misses && counters.start();
+    const uint64_t raysBefore = tracedRayCount();
+
+    std::unique_ptr<Sampler> sampler = createSampler(config.sampler, config.seed, samplerSamples(config));
+
+    // Rows a task shades before it finishes them, more than one only for the wavefront
+    // integrator. At most half a bucket, so other tasks can still steal rows of it.
+    std::vector<int> rows;
+    const int samplesPerRow = std::max(1, config.bucket_size * (job->accumulation ? (config.adaptive_sampling ? adaptiveRoundSamples(config) : 1)
+                                                                                   : config.sample_per_pixel));
+    const int rowsPerBatch = config.integrator == Integrator::Wavefront
+            ? std::max(1, std::min(WAVEFRONT_BATCH_SAMPLES / samplesPerRow, config.bucket_size / 2)) : 1;
+
+    // cancel and pause are checked between buckets, rows of started buckets are
+    // shared once there is no bucket left to start
+    int bucketIdx;
+    int run = workerIdx;
+    while (!job->cancelRequested.load() && !job->pauseRequested.load() && !deadlinePassed(*job)
+           && (scheduler.next(bucketIdx, run) || scheduler.steal(bucketIdx)))
+    {
+        const Bucket& region = scheduler.bucket(bucketIdx);
+        int y;
+        while (scheduler.claimRow(bucketIdx, y))
+        {
+            // more rows of the bucket while a wavefront batch is small
+            rows.assign(1, y);
+            while (static_cast<int>(rows.size()) < rowsPerBatch && scheduler.claimRow(bucketIdx, y))
+                rows.push_back(y);
+            shadeRows(job->scene, *sampler, job->buffer, job->accumulation.get(), region, rows, config);
+
+            for (size_t r = 0; r < rows.size(); ++r)
+            {
+                if (scheduler.finishRow(bucketIdx))
+                {
+                    if (config.print_info)
+                        std::cout<< renderProgress(*job) * 100 <<"% completed."<<std::endl;
+                    if (job->accumulation && config.on_tile_complete)
+                        config.on_tile_complete(*job->accumulation, region);
+                }
+            }
+        }
+    }
+
+    if (counting)
+        counters.stop();
+
+    std::unique_lock<std::mutex> lock(job->mtx);
+    job->stats.raysTraced += tracedRayCount() - raysBefore;
+    if (counting)
+    {
+        job->stats.cacheReferences += counters.references;
+        job->stats.cacheMisses += counters.misses;
+        job->stats.cacheCountersAvailable = true;
+    }
+
+    if (--job->activeTasks > 0)
+        return;
+
+    // last task of the pass: start the next progressive pass, finish, or go idle if paused
+    bool passDone = scheduler.completedCount() == scheduler.activeCount();
+    bool stop = job->cancelRequested.load() || deadlinePassed(*job);
+    if (passDone && job->accumulation)
+    {
+        int pass = ++job->completedPasses;
+
+        // only pass ends are saved, a resumed pass then starts on every pixel alike
+        auto now = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> sinceCheckpoint = now - job->lastCheckpoint;
+        bool checkpoint = !config.checkpoint_file.empty()
+                && (pass >= job->totalPasses || stop || deadlinePassed(*job)
+                    || sinceCheckpoint.count() >= config.checkpoint_interval_seconds);
+        if (checkpoint)
+            job->lastCheckpoint = now;
+
+        if (checkpoint || config.on_pass_complete)
+        {
+            // resume() and cancel() leave the job alone until the callback returns
+            job->betweenPasses = true;
+            lock.unlock();
+            if (checkpoint)
+                saveCheckpoint(*job, pass);
+            if (config.on_pass_complete)
+                config.on_pass_complete(*job->accumulation, pass);
+            lock.lock();
+            job->betweenPasses = false;
+        }
+
+        stop = job->cancelRequested.load() || deadlinePassed(*job);
+        if (config.adaptive_sampling && pass < job->totalPasses && !stop)
+        {
+            std::vector<int> tiles = unconvergedTiles(scheduler, *job->accumulation, config);
+            if (!tiles.empty())
+            {
+                scheduler.reset(tiles);
+                passDone = false;
+            }
+        }
+        else if (pass < job->totalPasses && !stop)
+        {
+            if (job->hasDeadline && pass >= UNIFORM_PASSES)
+                scheduler.reset(noisyTiles(scheduler, *job->accumulation));
+            else
+                scheduler.reset();
+            passDone = false;
+        }
+    }
+
+    if (passDone || stop)
+        finishJob(*job);
+    else if (!job->pauseRequested.load())
+        submitRenderTasks(job); // next pass, or resumed while the tasks were leaving
+    else
+        job->stateChanged.notify_all();
+}
+
+// job->mtx held
+void submitRenderTasks(const std::shared_ptr<RenderJobState>& job)
+{
+    job->activeTasks += job->numTasks;
+    for (int i = 0; i < job->numTasks; ++i)
+    {
+        std::shared_ptr<RenderJobState> taskJob = job;
+        job->context.pool().submit(job->tasks, [taskJob, i]() { renderTask(taskJob, i); });
+    }
+    job->stateChanged.notify_all();
+}
+
+// job.mtx held
+void finishJob(RenderJobState& job)
+{
+    const RenderConfig& config = job.config;
+    Scene& scene = job.scene;
+
+    std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - job.renderStart;
+    job.stats.renderSeconds = job.started ? duration.count() : 0;
+
+    if (config.print_info)
+    {
+        if (job.cancelRequested.load())
+            std::cout<<"Render cancelled"<<std::endl;
+        else
+            std::cout<<"Completed pixel-wise render"<<std::endl;
+        std::cout << "Time taken: " << job.stats.renderSeconds << " seconds\n";
+        if (job.stats.renderSeconds > 0)
+            std::cout<<"Rays: "<<job.stats.raysTraced<<", "<<job.stats.raysTraced / job.stats.renderSeconds * 1e-6<<" Mrays/s"<<std::endl;
+
+        if (config.count_cache_misses)
+        {
+            if (job.stats.cacheCountersAvailable)
+                std::cout<<"Cache misses: "<<job.stats.cacheMisses<<" of "<<job.stats.cacheReferences<<" references"<<std::endl;
+            else
+                std::cout<<"Cache counters are not available"<<std::endl;
+        }
+
+        if (scene.geometryPager)
+        {
+            GeometryPagerStats pagerStats = scene.geometryPager->stats();
+            std::cout<<"Geometry pages: "<<pagerStats.pageFaults<<" faults, "<<pagerStats.cacheHits<<" hits, "
+                     <<pagerStats.residentPages<<"/"<<pagerStats.maxResidentPages<<" resident of "
+                     <<pagerStats.pageCount<<std::endl;
+        }
+    }
+
+    if (job.accumulation)
+    {
+        job.buffer = job.accumulation->toPixelBuffer();
+        job.stats.passes = job.completedPasses.load();
+
+        // samples per bucket
+        const BucketScheduler* scheduler = job.scheduler.get();
+        for (int b = 0; scheduler && b < scheduler->bucketCount(); ++b)
+        {
+            const Bucket& tile = scheduler->bucket(b);
+            RegionSamples region;
+            region.region = tile;
+            region.minSamples = job.accumulation->getSampleCount(tile.x, tile.y);
+            region.maxSamples = region.minSamples;
+
+            long long total = 0;
+            for (int y = tile.y; y < tile.y + tile.height; ++y)
+            {
+                for (int x = tile.x; x < tile.x + tile.width; ++x)
+                {
+                    int n = job.accumulation->getSampleCount(x, y);
+                    region.minSamples = std::min(region.minSamples, n);
+                    region.maxSamples = std::max(region.maxSamples, n);
+                    total += n;
+                }
+            }
+            region.meanSamples = static_cast<float>(total) / (tile.width * tile.height);
+            job.stats.regionSamples.push_back(region);
+        }
+
+        if (config.print_info && !job.stats.regionSamples.empty())
+        {
+            int minSamples = job.stats.regionSamples[0].minSamples;
+            int maxSamples = 0;
+            for (const RegionSamples& region : job.stats.regionSamples)
+            {
+                minSamples = std::min(minSamples, region.minSamples);
+                maxSamples = std::max(maxSamples, region.maxSamples);
+            }
+            std::cout<<job.stats.passes<<" passes, "<<minSamples<<" to "<<maxSamples<<" samples per pixel"<<std::endl;
+        }
+    }
+
+    job.completed = !job.cancelRequested.load();
+    job.finished = true;
+    job.stateChanged.notify_all();
+}
+
+void setupTask(const std::shared_ptr<RenderJobState>& job)
+{
+    // BVH builds use the context's pool too, also when the waiting caller runs this
+    ThreadPool::Binding binding(job->context.pool());
+    const RenderConfig& config = job->config;
+
+    if (!job->cancelRequested.load())
+    {
+        prepareScene(job->context, job->scene, config);
+        placeBuffer(config, job->buffer);
+    }
+
+    if (config.resume_checkpoint && !config.checkpoint_file.empty() && !job->cancelRequested.load() && !loadCheckpoint(*job))
+        job->cancelRequested = true;
+
+    const int numTasks = config.num_threads > 0 ? config.num_threads : job->context.pool().workerCount() + 1;
+    job->scheduler.reset(new BucketScheduler(job->scene.width, job->scene.height, config.bucket_size, config.bucket_order, numTasks));
+    job->scene.bucketSize = config.bucket_size;
+    job->publishedScheduler = job->scheduler.get();
+
+    if (config.print_info)
         std::cout<<"Starting pixel-wise render"<<std::endl;
 
-    // Start timer
-    auto start = std::chrono::high_resolution_clock::now();
+    std::lock_guard<std::mutex> lock(job->mtx);
+    job->numTasks = numTasks;
+    job->started = true;
+    job->renderStart = std::chrono::high_resolution_clock::now();
 
-    bucketRender(scene, buffer, config.num_threads, config.bucket_size, config.ray_depth, config.sample_per_pixel);
+    // a checkpoint of the last pass leaves nothing to render
+    if (job->cancelRequested.load() || (job->accumulation && job->completedPasses.load() >= job->totalPasses))
+        finishJob(*job);
+    else if (!job->pauseRequested.load())
+        submitRenderTasks(job);
+    else
+        job->stateChanged.notify_all();
+}
 
-//    // End timer
-    auto end = std::chrono::high_resolution_clock::now();
+std::shared_ptr<RenderJobState> startRender(RenderContext& context, Scene& scene, RenderConfig& config)
+{
+    std::shared_ptr<RenderJobState> job = std::make_shared<RenderJobState>(context, scene, config);
+    context.pool().submit(job->tasks, [job]() { setupTask(job); });
+    return job;
+}
 
-    // Calculate duration
-    std::chrono::duration<double> duration = end - start;
-    if (printinfo)
+}
+
+namespace krt
+{
+
+RenderHandle::RenderHandle(std::shared_ptr<RenderJobState> job) : job(std::move(job)) {}
+
+float RenderHandle::progress() const
+{
+    return renderProgress(*job);
+}
+
+bool RenderHandle::isDone() const
+{
+    std::lock_guard<std::mutex> lock(job->mtx);
+    return job->finished;
+}
+
+void RenderHandle::wait()
+{
+    while (true)
     {
-        std::cout<<"Completed pixel-wise render"<<std::endl;
-        std::cout << "Time taken: " << duration.count() << " seconds\n";
+        // run render tasks while waiting, so waiting from a pool task cannot stall the pool
+        job->context.pool().wait(job->tasks);
+
+        std::unique_lock<std::mutex> lock(job->mtx);
+        if (job->finished)
+            return;
+
+        // paused, sleep until resumed or cancelled
+        job->stateChanged.wait(lock, [this]() { return job->finished || job->activeTasks > 0 || !job->tasks.done(); });
     }
+}
+
+const PixelBuffer& RenderHandle::get()
+{
+    wait();
+    return job->buffer;
+}
+
+RenderStats RenderHandle::stats()
+{
+    wait();
+    std::lock_guard<std::mutex> lock(job->mtx);
+    return job->stats;
+}
+
+void RenderHandle::cancel()
+{
+    std::lock_guard<std::mutex> lock(job->mtx);
+    job->cancelRequested = true;
+
+    // a paused render has no tasks left to notice
+    if (job->started && job->activeTasks == 0 && !job->finished && !job->betweenPasses)
+        finishJob(*job);
+}
+
+bool RenderHandle::isCancelled() const
+{
+    return job->cancelRequested.load();
+}
 
-    return buffer;
+void RenderHandle::pause()
+{
+    job->pauseRequested = true;
 }
 
+void RenderHandle::resume()
+{
+    std::lock_guard<std::mutex> lock(job->mtx);
+    job->pauseRequested = false;
 
+    if (job->started && job->activeTasks == 0 && !job->finished && !job->betweenPasses)
+        submitRenderTasks(job);
+}
+
+bool RenderHandle::isPaused() const
+{
+    return job->pauseRequested.load();
+}
+
+void prepareSceneForRender(RenderContext& context, Scene& scene, const RenderConfig& config)
+{
+    ThreadPool::Binding binding(context.pool());
+    prepareScene(context, scene, config);
+}
+
+PixelBuffer renderBucket(Scene& scene, const RenderConfig& config, const Bucket& bucket)
+{
+    std::unique_ptr<Sampler> sampler = createSampler(config.sampler, config.seed, config.sample_per_pixel);
+    PixelBuffer tile(bucket.width, bucket.height);
+    for (int y = 0; y < bucket.height; ++y)
+        for (int x = 0; x < bucket.width; ++x)
+            tile.setColor(x, y, renderPixel(scene, *sampler, bucket.x + x, bucket.y + y, config.buffer_width, config.buffer_height, config));
+    return tile;
+}
+
+RenderHandle renderSceneAsync(Scene& scene, RenderConfig& config)
+{
+    return renderSceneAsync(RenderContext::defaultContext(), scene, config);
+}
+
+RenderHandle renderSceneAsync(RenderContext& context, Scene& scene, RenderConfig& config)
+{
+    return RenderHandle(startRender(context, scene, config));
+}
+
+PixelBuffer renderSceneToBuffer(Scene& scene, RenderConfig& config)
+{
+    return renderSceneToBuffer(RenderContext::defaultContext(), scene, config);
+}
+
+PixelBuffer renderSceneToBuffer(RenderContext& context, Scene& scene, RenderConfig& config, RenderStats* stats)
+{
+    std::shared_ptr<RenderJobState> job = startRender(context, scene, config);
+    RenderHandle(job).wait();
+
+    if (stats)
+        *stats = job->stats;
+    return std::move(job->buffer);
+}
 
 }
@@ -0,0 +1,243 @@
+#include <kanima/util/threadPool.h>
+#include <kanima/util/parallelFor.h>
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// helper functions not exposed outside
+namespace
+{
+
+thread_local krt::ThreadPool* boundPool = nullptr;
+thread_local int boundWorker = -1; // queue index while running as a worker of boundPool
+
+}
+
+namespace krt
+{
+
+ThreadPool::Binding::Binding(ThreadPool& pool) : previous(boundPool)
+{
+    boundPool = &pool;
+}
+
+ThreadPool::Binding::~Binding()
+{
+    boundPool = previous;
+}
+
+ThreadPool* ThreadPool::bound()
+{
+    return boundPool;
+}
+
+ThreadPool::ThreadPool(int numWorkers) : queuedTasks(0)
+{
+    if (numWorkers <= 0)
+        numWorkers = std::max(1, defaultThreadCount() - 1);
+
+    for (int i = 0; i <= numWorkers; ++i)
+        queues.emplace_back(new TaskQueue());
+
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &cpus))
+                allowedCpus.push_back(cpu);
+    }
+#endif
+
+    for (int i = 0; i < numWorkers; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    wakeup.notify_all();
+
+    for (auto& t : workers)
+        t.join();
+}
+
+bool ThreadPool::pinWorkers(bool pin)
+{
+    std::lock_guard<std::mutex> lock(affinityMtx);
+    if (pin == pinned || allowedCpus.empty())
+        return false;
+
+#ifdef __linux__
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        if (pin)
+        {
+            CPU_SET(allowedCpus[i % allowedCpus.size()], &cpus);
+        }
+        else
+        {
+            for (int cpu : allowedCpus)
+                CPU_SET(cpu, &cpus);
+        }
+
+        if (pthread_setaffinity_np(workers[i].native_handle(), sizeof(cpus), &cpus) != 0)
+            return false;
+    }
+
+    pinned = pin;
+    return true;
+#else
+    return false;
+#endif
+}
+
+int ThreadPool::callerQueue() const
+{
+    // outside threads, and workers of another pool, share the last queue
+    return (boundPool == this && boundWorker >= 0) ? boundWorker : static_cast<int>(queues.size()) - 1;
+}
+
+void ThreadPool::submit(TaskGroup& group, std::function<void()> fn)
+{
+    group.pending++;
+
+    TaskQueue& queue = *queues[callerQueue()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mtx);
+        queue.tasks.push_back({std::move(fn), &group});
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        queuedTasks++;
+    }
+    wakeup.notify_one();
+}
+
+bool ThreadPool::popTask(int queueIdx, Task& task)
+{
+    const int n = static_cast<int>(queues.size());
+
+    // newest task of the own queue first, it is the most likely to be in cache
+    {
+        TaskQueue& own = *queues[queueIdx];
+        std::lock_guard<std::mutex> lock(own.mtx);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queuedTasks--;
+            return true;
+        }
+    }
+
+    // otherwise steal the oldest task of another queue
+    for (int k = 1; k < n; ++k)
+    {
+        TaskQueue& victim = *queues[(queueIdx + k) % n];
+        std::lock_guard<std::mutex> lock(victim.mtx);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queuedTasks--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::runTask(Task& task)
+{
+    task.fn();
+
+    // the group may be gone as soon as pending reaches zero, only the pool is touched after
+    if (task.group->pending.fetch_sub(1) == 1)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        wakeup.notify_all();
+    }
+}
+
+void ThreadPool::workerLoop(int workerIdx)
+{
+    boundPool = this;
+    boundWorker = workerIdx;
+
+    while (true)
+    {
+        Task task;
+        if (popTask(workerIdx, task))
+        {
+            runTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mtx);
+        wakeup.wait(lock, [this]() { return stopping || queuedTasks.load() > 0; });
+        if (stopping && queuedTasks.load() == 0)
+            return;
+    }
+}
+
+void ThreadPool::wait(TaskGroup& group)
+{
+    const int queueIdx = callerQueue();
+
+    while (group.pending.load() > 0)
+    {
+        Task task;
+        if (popTask(queueIdx, task))
+        {
+            runTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mtx);
+        wakeup.wait(lock, [&]() { return group.pending.load() == 0 || queuedTasks.load() > 0; });
+    }
+}
+
+void ThreadPool::parallelFor(int begin, int end, const std::function<void(int)>& body, int maxTasks)
+{
+    if (end <= begin)
+        return;
+
+    int numTasks = maxTasks > 0 ? maxTasks : workerCount() + 1;
+    numTasks = std::min(numTasks, end - begin);
+
+    if (numTasks == 1)
+    {
+        for (int i = begin; i < end; ++i)
+            body(i);
+        return;
+    }
+
+    std::atomic<int> next(begin);
+    auto runner = [&]()
+    {
+        for (int i = next.fetch_add(1); i < end; i = next.fetch_add(1))
+            body(i);
+    };
+
+    // the calling thread runs one of the tasks itself
+    TaskGroup group;
+    for (int t = 1; t < numTasks; ++t)
+        submit(group, runner);
+    runner();
+    wait(group);
+}
+
+}